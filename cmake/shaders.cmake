@@ -0,0 +1,70 @@
+# Offline GLSL -> SPIR-V compilation.
+#
+# Every shader in SHADER_DIR is compiled for OpenGL with glslangValidator, validated with spirv-val,
+# optimized with spirv-opt and validated again; a shader that fails any of these steps fails the build.
+# Modules are written to <binary dir>/spirv/<file>.spv, which is where Shader looks for them before
+# falling back to compiling the GLSL source at runtime.
+#
+# A feature that only exists as a #define (e.g. behind a GLSL extension) has no specialization constant;
+# a shader lists such defines on a "// spirv-variant: NAME" line and gets <file>.NAME.spv compiled with
+# -DNAME as well, which Shader loads in place of <file>.spv when the program asks for NAME.
+
+find_program(GLSLANG_VALIDATOR glslangValidator HINTS $ENV{VULKAN_SDK}/bin $ENV{VULKAN_SDK}/Bin)
+find_program(SPIRV_OPT         spirv-opt        HINTS $ENV{VULKAN_SDK}/bin $ENV{VULKAN_SDK}/Bin)
+find_program(SPIRV_VAL         spirv-val        HINTS $ENV{VULKAN_SDK}/bin $ENV{VULKAN_SDK}/Bin)
+
+function(add_spirv_shaders TARGET SHADER_DIR)
+    if (NOT GLSLANG_VALIDATOR OR NOT SPIRV_OPT OR NOT SPIRV_VAL)
+        message(FATAL_ERROR "glslangValidator, spirv-opt or spirv-val not found - install the Vulkan SDK, or configure with "
+                            "-DOPENGLGP_SPIRV_SHADERS=OFF to compile the shaders from GLSL at runtime")
+    endif()
+
+    file(GLOB SHADER_SOURCES CONFIGURE_DEPENDS
+         ${SHADER_DIR}/*.vert
+         ${SHADER_DIR}/*.frag
+         ${SHADER_DIR}/*.geom
+         ${SHADER_DIR}/*.comp)
+
+    set(SPIRV_DIR ${CMAKE_CURRENT_BINARY_DIR}/spirv)
+    set(SPIRV_MODULES "")
+
+    foreach(SHADER ${SHADER_SOURCES})
+        get_filename_component(SHADER_NAME ${SHADER} NAME)
+
+        file(STRINGS ${SHADER} VARIANT_LINES REGEX "^// spirv-variant: ")
+        set(VARIANTS "")
+        foreach(VARIANT_LINE ${VARIANT_LINES})
+            string(REGEX REPLACE "^// spirv-variant: *([A-Za-z0-9_]+).*$" "\\1" VARIANT ${VARIANT_LINE})
+            list(APPEND VARIANTS ${VARIANT})
+        endforeach()
+
+        # the empty entry is the module itself
+        foreach(VARIANT "" ${VARIANTS})
+            if (VARIANT STREQUAL "")
+                set(MODULE_NAME ${SHADER_NAME})
+                set(VARIANT_DEFINE "")
+            else()
+                set(MODULE_NAME ${SHADER_NAME}.${VARIANT})
+                set(VARIANT_DEFINE -D${VARIANT})
+            endif()
+            set(SPIRV_UNOPTIMIZED ${SPIRV_DIR}/${MODULE_NAME}.unopt.spv)
+            set(SPIRV_MODULE      ${SPIRV_DIR}/${MODULE_NAME}.spv)
+
+            add_custom_command(OUTPUT  ${SPIRV_MODULE}
+                               COMMAND ${CMAKE_COMMAND} -E make_directory ${SPIRV_DIR}
+                               COMMAND ${GLSLANG_VALIDATOR} -G --auto-map-locations ${VARIANT_DEFINE} -o ${SPIRV_UNOPTIMIZED} ${SHADER}
+                               COMMAND ${SPIRV_VAL} --target-env opengl4.5 ${SPIRV_UNOPTIMIZED}
+                               COMMAND ${SPIRV_OPT} -O --target-env=opengl4.5 ${SPIRV_UNOPTIMIZED} -o ${SPIRV_MODULE}
+                               COMMAND ${SPIRV_VAL} --target-env opengl4.5 ${SPIRV_MODULE}
+                               DEPENDS ${SHADER}
+                               COMMENT "Compiling ${MODULE_NAME} to SPIR-V"
+                               VERBATIM)
+
+            list(APPEND SPIRV_MODULES ${SPIRV_MODULE})
+        endforeach()
+    endforeach()
+
+    add_custom_target(${TARGET}Shaders DEPENDS ${SPIRV_MODULES} SOURCES ${SHADER_SOURCES})
+    set_target_properties(${TARGET}Shaders PROPERTIES FOLDER "CMake")
+    add_dependencies(${TARGET} ${TARGET}Shaders)
+endfunction()
@@ -2,9 +2,9 @@
     layout (location = 0 ) out vec4 FragColor;
     layout (location = 1) out vec4 BrightColor;
 
-    in vec3 TexCoords;
+    layout (location = 0) in vec3 TexCoords;
 
-    uniform samplerCube skybox;
+    layout (location = 0) uniform samplerCube skybox;
 
     void main()
     {    
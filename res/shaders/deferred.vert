@@ -0,0 +1,21 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+// the lighting pass of deferred shading runs object.frag, which reads the surface from the G-buffer and
+// none of these; they are written only so the interfaces match
+layout (location = 0) out vec3 FragPos;
+layout (location = 1) out vec3 Normal;
+layout (location = 2) out vec2 TexCoords;
+layout (location = 4) out vec3 WorldPos;
+layout (location = 5) flat out uint MaterialID;
+
+void main()
+{
+    FragPos = vec3(0.0);
+    Normal = vec3(0.0, 0.0, 1.0);
+    TexCoords = aTexCoords;
+    WorldPos = vec3(0.0);
+    MaterialID = 0u;
+    gl_Position = vec4(aPos, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 460 core
+
+// position stream only (Mesh::positionVAO, GeometryArena::positionVertexArray())
+layout (location = 0) in vec3 aPos;
+
+layout (location = 11) uniform mat4 model;
+layout (location = 12) uniform bool useInstanceMatrix; // InstanceCuller draw, the model matrix comes from the visible instances
+layout (location = 13) uniform bool useDrawRecords; // StaticBatch multi-draw, the model matrix comes from draws[gl_DrawID]
+layout (location = 2) uniform mat4 view;
+layout (location = 1) uniform mat4 projection;
+
+struct DrawRecord {
+    mat4 model;
+    uint materialID;
+};
+
+layout (std430, binding = 3) readonly buffer DrawRecords {
+    DrawRecord draws[];
+};
+
+// instances culled by InstanceCuller: the survivors of this draw's view start at visible[gl_BaseInstance]
+layout (std430, binding = 4) readonly buffer Instances {
+    mat4 instances[];
+};
+
+layout (std430, binding = 5) readonly buffer VisibleInstances {
+    uint visible[];
+};
+
+// the shading vertex shaders compute gl_Position the same way, so their depth matches the prepass exactly
+invariant gl_Position;
+
+void main()
+{
+    mat4 finalModel = useDrawRecords ? draws[gl_DrawID].model : (useInstanceMatrix ? instances[visible[gl_BaseInstance + gl_InstanceID]] : model);
+    gl_Position = projection * view * finalModel * vec4(aPos, 1.0);
+}
@@ -1,8 +1,8 @@
 #version 460 core
 out vec4 FragColor;
-in vec3 WorldPos;
+layout (location = 1) in vec3 WorldPos;
 
-uniform samplerCube environmentMap;
+layout (location = 31) uniform samplerCube environmentMap;
 
 const float PI = 3.14159265359;
 
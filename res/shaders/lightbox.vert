@@ -3,18 +3,25 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-out VS_OUT {
+layout (location = 0) out VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
 } vs_out;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+invariant gl_Position; // see object.vert
+
+layout (location = 1) uniform mat4 projection;
+layout (location = 2) uniform mat4 view;
+
+// model matrices of the RenderQueue's draws, each draw's at its gl_BaseInstance
+layout (std430, binding = 12) readonly buffer Transforms {
+    mat4 transforms[];
+};
 
 void main()
 {
+    mat4 model = transforms[gl_BaseInstance];
     vs_out.FragPos = vec3(model * vec4(aPos, 1.0));   
     vs_out.TexCoords = aTexCoords;
         
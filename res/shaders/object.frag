@@ -1,4 +1,8 @@
 #version 460 core
+#ifdef MATERIAL_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#extension GL_NV_gpu_shader5 : enable
+#endif
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BrightColor; 
 
@@ -18,68 +22,148 @@ struct DirLight {
     vec3 specular;
 };
 
-struct PointLight {
+// point and spot lights, binned per cluster by lightcull.comp; see LightClusters. Point lights have
+// spotCosOuter = -1, light 0 casts the cube map shadow
+struct Light {
     vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
+    float range;
+    vec3 color;
+    float spotCosInner;
+    vec3 direction;
+    float spotCosOuter;
 };
 
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
+// must match LightClusters
+const uvec3 CLUSTER_GRID = uvec3(16, 9, 24);
+
+layout (std430, binding = 8) readonly buffer Lights {
+    Light lights[];
 };
 
-#define NR_POINT_LIGHTS 1
+layout (std430, binding = 9) readonly buffer LightGrid {
+    uvec2 clusterLightRange[]; // first entry in clusterLights, count
+};
 
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoords;
-in vec4 FragPosLightSpace;
-in vec3 WorldPos;
+layout (std430, binding = 10) readonly buffer LightIndices {
+    uint clusterLights[];
+};
+
+layout (location = 37) uniform vec2 clusterTileSize;    // pixels per cluster column and row
+layout (location = 38) uniform float clusterDepthScale; // slice = log(view depth) * scale - bias
+layout (location = 39) uniform float clusterDepthBias;
+
+// MATERIAL_TABLE != 0 reads the maps through MaterialTable records instead of the material.* samplers;
+// MATERIAL_BINDLESS only exists as a #define, the extension has no SPIR-V path here
+#ifdef GL_SPIRV
+layout (constant_id = 1) const int MATERIAL_TABLE = 0;
+#elif !defined(MATERIAL_TABLE)
+#define MATERIAL_TABLE 0
+#endif
+
+// DEFERRED selects what the program does with a surface: 0 shades it (forward), 1 writes it to the G-buffer
+// instead (geometry pass), 2 reads it back from the G-buffer under a full-screen quad (deferred.vert) and shades it
+#ifdef GL_SPIRV
+layout (constant_id = 3) const int DEFERRED = 0;
+#elif !defined(DEFERRED)
+#define DEFERRED 0
+#endif
+
+// DEPTH_ONLY != 0 runs only the alpha test, for the depth prepass of alpha tested geometry
+#ifdef GL_SPIRV
+layout (constant_id = 4) const int DEPTH_ONLY = 0;
+#elif !defined(DEPTH_ONLY)
+#define DEPTH_ONLY 0
+#endif
+
+// the G-buffer: albedo (as stored in the map) and ao; octahedral normal, roughness and metallic; depth
+layout (binding = 21, location = 40) uniform sampler2D gAlbedoAO;
+layout (binding = 22, location = 41) uniform sampler2D gNormalRoughnessMetallic;
+layout (binding = 23, location = 42) uniform sampler2D gDepth;
+layout (location = 43) uniform mat4 inverseViewProjection;
+layout (location = 44) uniform vec2 renderSize; // the corner of the G-buffer the scene was rendered to
+
+// one uvec2 per map (albedo, ao, metallic, normal, roughness): a bindless handle or (page, layer)
+struct MaterialRecord {
+    uvec2 maps[5];
+};
+
+layout (std430, binding = 2) readonly buffer MaterialTable {
+    MaterialRecord materials[];
+};
+
+#define MAX_MATERIAL_PAGES 8
+layout (binding = 24, location = 45) uniform sampler2DArray materialPages[MAX_MATERIAL_PAGES];
+
+layout (location = 0) in vec3 FragPos;
+layout (location = 1) in vec3 Normal;
+layout (location = 2) in vec2 TexCoords;
+layout (location = 4) in vec3 WorldPos;
+layout (location = 5) flat in uint MaterialID;
 
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform Material material;
+layout (location = 53) uniform vec3 viewPos;
+layout (location = 54) uniform DirLight dirLight;
+layout (location = 58) uniform Material material;
 
-uniform sampler2D texture_diffuse1;
-uniform sampler2D shadowMap;
-uniform samplerCube depthMap;
-uniform samplerCube irradianceMap;
-uniform samplerCube prefilterMap;
-uniform sampler2D brdfLUT;
+layout (location = 63) uniform sampler2D texture_diffuse1;
+layout (location = 64) uniform sampler2DArray shadowMap;
+layout (location = 65) uniform samplerCube depthMap;
+layout (location = 66) uniform samplerCube irradianceMap;
+layout (location = 67) uniform samplerCube prefilterMap;
+layout (location = 68) uniform sampler2D brdfLUT;
 
-uniform float far_plane;
+layout (location = 69) uniform float far_plane;
+
+// directional light cascades, see CascadedShadowMap; must match CascadedShadowMap::CascadeCount
+const int CASCADE_COUNT = 4;
+layout (location = 70) uniform mat4 cascadeMatrices[CASCADE_COUNT];
+layout (location = 74) uniform float cascadeSplits[CASCADE_COUNT]; // far end of every cascade in view space depth
+layout (location = 2) uniform mat4 view;
 
 const float PI = 3.14159265359;
 
+// the surface being shaded: interpolated in forward and geometry passes, reconstructed from the G-buffer
+// in the deferred lighting pass
+vec3 surfacePos;
+vec3 surfaceNormal; // geometric normal, for the shadow bias
+
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-float DirectionalShadowCalculation(vec4 fragPosLightSpace);
+float DirectionalShadowCalculation(vec3 fragPos);
 float PointShadowCalculation(vec3 fragPos, vec3 N);
 
+// sampler arrays may only be indexed with constants, the gradients are taken outside the switch
+vec4 samplePage(uint page, vec3 uvw, vec2 dx, vec2 dy)
+{
+    switch (page) {
+    case 0u: return textureGrad(materialPages[0], uvw, dx, dy);
+    case 1u: return textureGrad(materialPages[1], uvw, dx, dy);
+    case 2u: return textureGrad(materialPages[2], uvw, dx, dy);
+    case 3u: return textureGrad(materialPages[3], uvw, dx, dy);
+    case 4u: return textureGrad(materialPages[4], uvw, dx, dy);
+    case 5u: return textureGrad(materialPages[5], uvw, dx, dy);
+    case 6u: return textureGrad(materialPages[6], uvw, dx, dy);
+    default: return textureGrad(materialPages[7], uvw, dx, dy);
+    }
+}
+
+vec4 sampleMaterial(int map, sampler2D discreteMap)
+{
+    if (MATERIAL_TABLE == 0)
+        return texture(discreteMap, TexCoords);
+
+    uvec2 entry = materials[MaterialID].maps[map];
+#ifdef MATERIAL_BINDLESS
+    return texture(sampler2D(entry), TexCoords);
+#else
+    vec2 dx = dFdx(TexCoords);
+    vec2 dy = dFdy(TexCoords);
+    return samplePage(entry.x, vec3(TexCoords, float(entry.y)), dx, dy);
+#endif
+}
+
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(material.normalMap, TexCoords).xyz * 2.0 - 1.0;
+    vec3 tangentNormal = sampleMaterial(3, material.normalMap).xyz * 2.0 - 1.0;
 
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
@@ -139,20 +223,24 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }  
 
-vec3 calculateSpotLight(vec3 N, vec3 V, vec3 albedo, vec3 F0, float metallic, float roughness)
+// Cook-Torrance for a point or spot light, inverse square falloff windowed to zero at the light's range
+vec3 calculateLight(Light light, vec3 N, vec3 V, vec3 albedo, vec3 F0, float metallic, float roughness)
 {
-    vec3 L = normalize(spotLight.position - WorldPos);
+    vec3 L = normalize(light.position - surfacePos);
     vec3 H = normalize(V + L);
 
-    float distance = length(spotLight.position - WorldPos);
-    float attenuation = 1.0 / (distance * distance);
-    vec3 radiance = spotLight.diffuse * attenuation;
+    float distance = length(light.position - surfacePos);
+    float window = clamp(1.0 - pow(distance / light.range, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (distance * distance);
+    vec3 radiance = light.color * attenuation;
 
-    // Spotlight cone calculation
-    float theta = dot(L, normalize(-spotLight.direction));
-    float epsilon = spotLight.cutOff - spotLight.outerCutOff;
-    float intensity = clamp((theta - spotLight.outerCutOff) / epsilon, 0.0, 1.0);
-    radiance *= intensity;
+    // spot cone
+    if (light.spotCosOuter > -1.0)
+    {
+        float theta = dot(L, normalize(-light.direction));
+        float epsilon = light.spotCosInner - light.spotCosOuter;
+        radiance *= clamp((theta - light.spotCosOuter) / epsilon, 0.0, 1.0);
+    }
 
     // Cook-Torrance BRDF
     float NDF = DistributionGGX(N, H, roughness);
@@ -160,9 +248,10 @@ vec3 calculateSpotLight(vec3 N, vec3 V, vec3 albedo, vec3 F0, float metallic, fl
     vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
 
     vec3 numerator = NDF * G * F;
-    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
     vec3 specular = numerator / denominator;
 
+    // kS is equal to Fresnel; the diffuse share is what is left of it, and metals have none
     vec3 kS = F;
     vec3 kD = vec3(1.0) - kS;
     kD *= 1.0 - metallic;
@@ -172,6 +261,15 @@ vec3 calculateSpotLight(vec3 N, vec3 V, vec3 albedo, vec3 F0, float metallic, fl
     return (kD * albedo / PI + specular) * radiance * NdotL;
 }
 
+// the cluster of this fragment in the LightGrid
+uint clusterIndex()
+{
+    float viewDepth = -(view * vec4(surfacePos, 1.0)).z;
+    uint slice = uint(clamp(log(viewDepth) * clusterDepthScale - clusterDepthBias, 0.0, float(CLUSTER_GRID.z - 1u)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), CLUSTER_GRID.xy - 1u);
+    return tile.x + CLUSTER_GRID.x * (tile.y + CLUSTER_GRID.y * slice);
+}
+
 vec3 calculateDirectionalLight(vec3 N, vec3 V, vec3 albedo, vec3 F0, float metallic, float roughness) {
     vec3 L = normalize(-dirLight.direction);  // Directional light vector
     vec3 H = normalize(V + L);               // Halfway vector
@@ -204,20 +302,74 @@ vec3 calculateDirectionalLight(vec3 N, vec3 V, vec3 albedo, vec3 F0, float metal
     return Lo;
 }
 
+// octahedral mapping of a unit vector to [0,1]^2, 16 bits per component keep it well under a degree
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return e * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 e)
+{
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 
 
 void main()
 {   
-    vec3 albedo     = pow(texture(material.albedoMap, TexCoords).rgb, vec3(2.2));
-    float alpha     = texture(material.albedoMap,TexCoords).a;
-    if(alpha<0.1){
-    discard;
+    vec4 albedoSample;
+    float metallic, roughness, ao;
+    vec3 N;
+    if (DEFERRED == 2)
+    {
+        // nothing was drawn where the depth is cleared, the skybox stays
+        ivec2 texel = ivec2(gl_FragCoord.xy);
+        float depth = texelFetch(gDepth, texel, 0).r;
+        if (depth == 1.0)
+            discard;
+        vec4 clip = inverseViewProjection * vec4(gl_FragCoord.xy / renderSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+        surfacePos = clip.xyz / clip.w;
+
+        albedoSample = vec4(texelFetch(gAlbedoAO, texel, 0).rgb, 1.0);
+        ao = texelFetch(gAlbedoAO, texel, 0).a;
+        vec4 surface = texelFetch(gNormalRoughnessMetallic, texel, 0);
+        N = decodeNormal(surface.xy);
+        roughness = surface.z;
+        metallic = surface.w;
+        surfaceNormal = N;
+    }
+    else
+    {
+        surfacePos = WorldPos;
+        surfaceNormal = normalize(Normal);
+        albedoSample = sampleMaterial(0, material.albedoMap);
+        if(albedoSample.a<0.1){
+        discard;
+        }
+        if (DEPTH_ONLY != 0)
+            return;
+        metallic  = sampleMaterial(2, material.metallicMap).r;
+        roughness = sampleMaterial(4, material.roughnessMap).r;
+        ao        = sampleMaterial(1, material.aoMap).r;
+        N = getNormalFromMap();
     }
-    float metallic  = texture(material.metallicMap, TexCoords).r;
-    float roughness = texture(material.roughnessMap, TexCoords).r;
-    float ao        = texture(material.aoMap, TexCoords).r;
-    vec3 N = getNormalFromMap();
-    vec3 V = normalize(viewPos - WorldPos);
+
+    if (DEFERRED == 1)
+    {
+        // the two color outputs are the G-buffer targets here
+        FragColor = vec4(albedoSample.rgb, ao);
+        BrightColor = vec4(encodeNormal(N), roughness, metallic);
+        return;
+    }
+
+    vec3 albedo     = pow(albedoSample.rgb, vec3(2.2));
+    vec3 V = normalize(viewPos - surfacePos);
     vec3 R = reflect(-V, N); 
     FragColor = vec4(0);
 
@@ -227,52 +379,21 @@ void main()
     F0 = mix(F0, albedo, metallic);
     //F0 = vec3(1.0);
 
-    // reflectance equation
+    // reflectance equation: only the lights binned into this fragment's cluster
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < NR_POINT_LIGHTS; ++i) 
+    uint cluster = clusterIndex();
+    uvec2 clusterRange = clusterLightRange[cluster];
+    for(uint i = 0u; i < clusterRange.y; ++i)
     {
-        // calculate per-light radiance
-        vec3 L = normalize(pointLights[i].position - WorldPos);
-        vec3 H = normalize(V + L);
-        float distance = length(pointLights[i].position - WorldPos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = pointLights[i].diffuse * attenuation;
-
-        // Cook-Torrance BRDF
-        float NDF = DistributionGGX(N, H, roughness);   
-        float G   = GeometrySmith(N, V, L, roughness);      
-        vec3 F    = fresnelSchlick(max(dot(H, V), 0.0), F0);
-           
-        vec3 numerator    = NDF * G * F; 
-        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001; // + 0.0001 to prevent divide by zero
-        vec3 specular = numerator / denominator;
-        
-        // kS is equal to Fresnel
-        vec3 kS = F;
-        // for energy conservation, the diffuse and specular light can't
-        // be above 1.0 (unless the surface emits light); to preserve this
-        // relationship the diffuse component (kD) should equal 1.0 - kS.
-        vec3 kD = vec3(1.0) - kS;
-        // multiply kD by the inverse metalness such that only non-metals 
-        // have diffuse lighting, or a linear blend if partly metal (pure metals
-        // have no diffuse light).
-        kD *= 1.0 - metallic;	  
-
-        // scale light by NdotL
-        float NdotL = max(dot(N, L), 0.0);        
-
-        float shadow = PointShadowCalculation(FragPos, N)*1.5;
-        FragColor += vec4(vec3(shadow),1);
-        // for debug
-        // add to outgoing radiance Lo
-        Lo += (1.0-shadow) * (kD * albedo / PI + specular) * radiance * NdotL;  // note that we already multiplied the BRDF by the Fresnel (kS) so we won't multiply by kS again
-    }   
-
-    // Add spotlight contribution
-    Lo += calculateSpotLight(N, V, albedo, F0, metallic, roughness);
+        uint lightIndex = clusterLights[clusterRange.x + i];
+        vec3 radiance = calculateLight(lights[lightIndex], N, V, albedo, F0, metallic, roughness);
+        if (lightIndex == 0u)
+            radiance *= 1.0 - PointShadowCalculation(surfacePos, N)*1.5;
+        Lo += radiance;
+    }
 
 // Add directional light contribution
-    float shadow = DirectionalShadowCalculation(FragPosLightSpace)*1.5;
+    float shadow = DirectionalShadowCalculation(surfacePos)*1.5;
 
     Lo += (1.0-shadow) *  calculateDirectionalLight(N, V, albedo, F0, metallic, roughness);
 
@@ -318,8 +439,17 @@ void main()
         BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
 }
 
-float DirectionalShadowCalculation(vec4 fragPosLightSpace)
+float DirectionalShadowCalculation(vec3 fragPos)
 {
+    // the first cascade reaching past the fragment, nothing beyond the last one is shadowed
+    float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = 0;
+    while (cascade < CASCADE_COUNT && viewDepth > cascadeSplits[cascade])
+        ++cascade;
+    if (cascade == CASCADE_COUNT)
+        return 0.0;
+    vec4 fragPosLightSpace = cascadeMatrices[cascade] * vec4(fragPos, 1.0);
+
     // perform perspective divide
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     // transform to [0,1] range
@@ -328,19 +458,19 @@ float DirectionalShadowCalculation(vec4 fragPosLightSpace)
 
 
 
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
+    float closestDepth = texture(shadowMap, vec3(projCoords.xy, cascade)).r; 
     // get depth of current fragment from light's perspective
     float currentDepth = projCoords.z;
     // check whether current frag pos is in shadow
 
-    float bias = max(0.05 * (1.0 - dot(normalize(Normal), dirLight.direction)), 0.005);
+    float bias = max(0.05 * (1.0 - dot(surfaceNormal, dirLight.direction)), 0.005);
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
     for(int x = -2; x <= 2; ++x) // Expand the kernel
     {
         for(int y = -2; y <= 2; ++y)
         {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
+            float pcfDepth = texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r; 
             shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
         }    
     }
@@ -351,7 +481,7 @@ float DirectionalShadowCalculation(vec4 fragPosLightSpace)
 
 float PointShadowCalculation(vec3 fragPos, vec3 N) {
     // Compute the direction from fragment to the light
-    vec3 fragToLight = fragPos - pointLights[0].position;
+    vec3 fragToLight = fragPos - lights[0].position;
     vec3 fragToLightDir = normalize(fragToLight);
     
     // Sample the depth map from the point light's cube map (depth cube map)
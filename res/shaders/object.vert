@@ -2,24 +2,43 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 7) in uint aMaterialID; // the current attribute value, set per draw
 
-out vec3 FragPos;
-out vec3 Normal;
-out vec2 TexCoords;
-out vec4 FragPosLightSpace;
-out vec3 WorldPos;
+layout (location = 0) out vec3 FragPos;
+layout (location = 1) out vec3 Normal;
+layout (location = 2) out vec2 TexCoords;
+layout (location = 4) out vec3 WorldPos;
+layout (location = 5) flat out uint MaterialID;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+// bit-identical to depthprepass.vert, the scene pass depth tests GL_EQUAL against the prepass
+invariant gl_Position;
+
+layout (location = 13) uniform bool useDrawRecords;
+layout (location = 2) uniform mat4 view;
+layout (location = 1) uniform mat4 projection;
+
+// per-draw data of StaticBatch multi-draws, indexed by gl_DrawID while useDrawRecords is set
+struct DrawRecord {
+    mat4 model;
+    uint materialID;
+};
+
+layout (std430, binding = 3) readonly buffer DrawRecords {
+    DrawRecord draws[];
+};
+
+// model matrices of the RenderQueue's draws, each draw's at its gl_BaseInstance
+layout (std430, binding = 12) readonly buffer Transforms {
+    mat4 transforms[];
+};
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    mat4 finalModel = useDrawRecords ? draws[gl_DrawID].model : transforms[gl_BaseInstance];
+    FragPos = vec3(finalModel * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(finalModel))) * aNormal;
     TexCoords = aTexCoords;
-    WorldPos = vec3(model * vec4(aPos, 1.0));
-    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    MaterialID = useDrawRecords ? draws[gl_DrawID].materialID : aMaterialID;
+    WorldPos = vec3(finalModel * vec4(aPos, 1.0));
+    gl_Position = projection * view * finalModel * vec4(aPos, 1.0);
 }
\ No newline at end of file
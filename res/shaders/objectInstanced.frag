@@ -1,9 +1,9 @@
 #version 460 core
 out vec4 FragColor;
 
-in vec2 TexCoords;
+layout (location = 2) in vec2 TexCoords;
 
-uniform sampler2D texture_diffuse1;
+layout (location = 63) uniform sampler2D texture_diffuse1;
 
 void main()
 {
@@ -2,25 +2,36 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in mat4 instanceMatrix;
+layout (location = 7) in uint aMaterialID; // the current attribute value, set per draw
 
-out vec3 FragPos;
-out vec3 Normal;
-out vec2 TexCoords;
-out vec4 FragPosLightSpace;
-out vec3 WorldPos;
+layout (location = 0) out vec3 FragPos;
+layout (location = 1) out vec3 Normal;
+layout (location = 2) out vec2 TexCoords;
+layout (location = 4) out vec3 WorldPos;
+layout (location = 5) flat out uint MaterialID;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+invariant gl_Position; // see object.vert
+
+layout (location = 11) uniform mat4 model;
+layout (location = 2) uniform mat4 view;
+layout (location = 1) uniform mat4 projection;
+
+// instances culled by InstanceCuller: the survivors of this draw's view start at visible[gl_BaseInstance]
+layout (std430, binding = 4) readonly buffer Instances {
+    mat4 instances[];
+};
+
+layout (std430, binding = 5) readonly buffer VisibleInstances {
+    uint visible[];
+};
 
 void main()
 {
+    mat4 instanceMatrix = instances[visible[gl_BaseInstance + gl_InstanceID]];
     FragPos = vec3(instanceMatrix * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(instanceMatrix))) * aNormal;
     TexCoords = aTexCoords;
+    MaterialID = aMaterialID;
     WorldPos = vec3(instanceMatrix * vec4(aPos, 1.0));
-    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
     gl_Position = projection * view * instanceMatrix * vec4(aPos, 1.0);
 }
\ No newline at end of file
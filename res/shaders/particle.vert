@@ -17,9 +17,9 @@ layout(std430, binding = 0) readonly restrict buffer Particles {
 
 layout(location = 0) in vec2 aPos; // in [-0.5, 0.5]
 
-layout(location = 0) uniform mat4 u_viewProj;
-layout(location = 1) uniform vec3 u_cameraRight;
-layout(location = 2) uniform vec3 u_cameraUp;
+layout(location = 80) uniform mat4 u_viewProj;
+layout(location = 81) uniform vec3 u_cameraRight;
+layout(location = 82) uniform vec3 u_cameraUp;
 
 layout(location = 0) out vec2 vTexCoord;
 layout(location = 1) out vec4 vColor;
@@ -0,0 +1,58 @@
+#version 460 core
+layout (location = 0) out vec4 FragColor;
+
+layout (binding = 8, location = 83) uniform sampler2D particles;      // cleared to zero, particles leave alpha above zero
+layout (binding = 9, location = 84) uniform sampler2D particleDepth;  // the depth the particles were tested against
+layout (binding = 10, location = 85) uniform sampler2D sceneDepth;
+
+layout (location = 35) uniform float zNear;
+layout (location = 36) uniform float zFar;
+layout (location = 86) uniform int divisor;
+layout (location = 87) uniform vec2 extent; // the corner of the particle targets they were drawn to
+
+// relative depth difference at which a low resolution texel stops counting for a pixel
+const float DEPTH_TOLERANCE = 0.05;
+
+float linearDepth(float depth)
+{
+    const float z = depth * 2.0 - 1.0;
+    return 2.0 * zNear * zFar / (zFar + zNear - z * (zFar - zNear));
+}
+
+// bilateral upsample: the bilinear weights of the four texels around the pixel, each scaled down by how far
+// its depth is from the pixel's. Where none of them is near (a thin object the downsample lost), the one
+// nearest in depth is taken alone
+void main()
+{
+    const float depth = linearDepth(texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r);
+    const ivec2 size = ivec2(extent);
+    const vec2 position = gl_FragCoord.xy / float(divisor) - 0.5;
+    const ivec2 base = ivec2(floor(position));
+    const vec2 f = position - vec2(base);
+
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    vec4 nearestColor = vec4(0.0);
+    float nearestDifference = 1e30;
+    for (int i = 0; i < 4; i++)
+    {
+        const ivec2 offset = ivec2(i & 1, i >> 1);
+        const ivec2 texel = clamp(base + offset, ivec2(0), size - 1);
+        const vec4 particle = texelFetch(particles, texel, 0);
+        // the particles are alpha tested: a texel is covered or not
+        const vec4 color = particle.a > 0.0 ? vec4(particle.rgb, 1.0) : vec4(0.0);
+
+        const float difference = abs(linearDepth(texelFetch(particleDepth, texel, 0).r) - depth) / depth;
+        const vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        const float closeness = max(0.0, 1.0 - difference / DEPTH_TOLERANCE);
+        const float weight = bilinear.x * bilinear.y * closeness * closeness;
+        sum += color * weight;
+        weightSum += weight;
+        if (difference < nearestDifference)
+        {
+            nearestDifference = difference;
+            nearestColor = color;
+        }
+    }
+    FragColor = weightSum > 1e-4 ? sum / weightSum : nearestColor;
+}
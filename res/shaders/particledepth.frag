@@ -0,0 +1,20 @@
+#version 460 core
+layout (location = 0) out float depthCopy;
+
+layout (binding = 10, location = 85) uniform sampler2D sceneDepth;
+
+layout (location = 86) uniform int divisor;
+
+// the nearest depth of the divisor x divisor block this texel covers, as the depth and as a color for the
+// upsample: a particle behind any part of an occluder is dropped at the edge rather than bleeding over it
+void main()
+{
+    const ivec2 base = ivec2(gl_FragCoord.xy) * divisor;
+    const ivec2 last = textureSize(sceneDepth, 0) - 1;
+    float nearest = 1.0;
+    for (int y = 0; y < divisor; y++)
+        for (int x = 0; x < divisor; x++)
+            nearest = min(nearest, texelFetch(sceneDepth, min(base + ivec2(x, y), last), 0).r);
+    gl_FragDepth = nearest;
+    depthCopy = nearest;
+}
@@ -1,8 +1,8 @@
 #version 460 core
-in vec4 FragPos;
+layout (location = 0) in vec4 FragPos;
 
-uniform vec3 lightPos;
-uniform float far_plane;
+layout (location = 102) uniform vec3 lightPos;
+layout (location = 69) uniform float far_plane;
 
 void main()
 {
@@ -1,13 +1,65 @@
 #version 460 core
+// VERTEX_LAYER: the vertex shader picks the cube face itself (GL_ARB_shader_viewport_layer_array); otherwise
+// pointshadowmap.geom passes each triangle through to the face in vLayer. Not a specialization constant since it
+// gates an extension, the build compiles it as a separate module instead
+// spirv-variant: VERTEX_LAYER
+#ifdef VERTEX_LAYER
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
 layout (location = 0) in vec3 aPos;
-layout (location = 3) in mat4 instanceMatrix;
 
-uniform mat4 model;
-uniform bool useInstanceMatrix;
+layout (location = 0) out vec4 FragPos;
+#ifndef VERTEX_LAYER
+layout (location = 1) flat out int vLayer;
+#endif
+
+layout (location = 103) uniform mat4 shadowMatrices[6];
+// >= 0: the draw was culled for this face and goes to it alone; -1: each draw's faces are the set bits of
+// gl_BaseInstance and instance i goes to the i-th of them (StaticBatch::drawShadowCastersLayered)
+layout (location = 109) uniform int face;
+
+layout (location = 11) uniform mat4 model;
+layout (location = 12) uniform bool useInstanceMatrix;
+layout (location = 13) uniform bool useDrawRecords; // StaticBatch multi-draw, the model matrix comes from draws[gl_DrawID]
+
+struct DrawRecord {
+    mat4 model;
+    uint materialID;
+};
+
+layout (std430, binding = 3) readonly buffer DrawRecords {
+    DrawRecord draws[];
+};
+
+// instances culled by InstanceCuller: the survivors of this draw's view start at visible[gl_BaseInstance]
+layout (std430, binding = 4) readonly buffer Instances {
+    mat4 instances[];
+};
+
+layout (std430, binding = 5) readonly buffer VisibleInstances {
+    uint visible[];
+};
 
 void main()
 {
-    mat4 finalModel = useInstanceMatrix ? instanceMatrix : model;
+    mat4 finalModel = useDrawRecords ? draws[gl_DrawID].model : (useInstanceMatrix ? instances[visible[gl_BaseInstance + gl_InstanceID]] : model);
+
+    FragPos = finalModel * vec4(aPos, 1.0);
+
+    int layer = face;
+    if (layer < 0)
+    {
+        uint faces = uint(gl_BaseInstance);
+        for (int i = 0; i < gl_InstanceID; ++i)
+            faces &= faces - 1u; // drop the lowest face
+        layer = findLSB(faces);
+    }
 
-    gl_Position = finalModel * vec4(aPos, 1.0);
+#ifdef VERTEX_LAYER
+    gl_Layer = layer;
+    gl_Position = shadowMatrices[layer] * FragPos;
+#else
+    vLayer = layer;
+    gl_Position = FragPos;
+#endif
 }  
\ No newline at end of file
@@ -0,0 +1,154 @@
+#version 460 core
+layout (location = 0) out vec4 FragColor;
+
+layout (location = 0) in vec2 TexCoords;
+
+// features of PostProcess, every combination is its own program
+#ifdef GL_SPIRV
+layout (constant_id = 0) const int BLOOM = 1;
+layout (constant_id = 1) const int VIGNETTE = 1;
+layout (constant_id = 2) const int COLOR_GRADING = 1;
+layout (constant_id = 3) const int FXAA = 1;
+layout (constant_id = 4) const int UPSCALE = 0;
+#else
+#ifndef BLOOM
+#define BLOOM 1
+#endif
+#ifndef VIGNETTE
+#define VIGNETTE 1
+#endif
+#ifndef COLOR_GRADING
+#define COLOR_GRADING 1
+#endif
+#ifndef FXAA
+#define FXAA 1
+#endif
+#ifndef UPSCALE
+#define UPSCALE 0
+#endif
+#endif
+
+layout (binding = 18, location = 110) uniform sampler2D scene;
+layout (binding = 19, location = 111) uniform sampler2D bloomBlur;      // level 0 of the bloom chain
+layout (binding = 17, location = 112) uniform sampler3D colorGradingLut;
+
+layout (location = 113) uniform float exposure;
+layout (location = 114) uniform float vignetteStrength;
+layout (location = 10) uniform vec2 uvScale; // the corner of scene and bloomBlur the scene was rendered to, in texture coordinates
+
+const float LUT_SIZE = 32.0; // must match PostProcess
+
+// keeps a tap inside the rendered corner; the rest of the target holds whatever an earlier frame left there
+vec2 rendered(vec2 uv, vec2 size)
+{
+    return min(uv, uvScale - 0.5 / size);
+}
+
+vec3 sceneTap(vec2 uv)
+{
+    return texture(scene, rendered(uv, vec2(textureSize(scene, 0)))).rgb;
+}
+
+// the scene rendered below the output resolution, resampled with a Catmull-Rom filter: the 4x4 texel
+// footprint in nine bilinear taps, the middle two weights of each axis merged into one tap between them
+vec3 upscaled(vec2 uv)
+{
+    const vec2 size = vec2(textureSize(scene, 0));
+    const vec2 position = uv * size;
+    const vec2 center = floor(position - 0.5) + 0.5;
+    const vec2 f = position - center;
+
+    const vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    const vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    const vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    const vec2 w3 = f * f * (-0.5 + 0.5 * f);
+    const vec2 w12 = w1 + w2;
+
+    const vec2 uv0 = (center - 1.0) / size;
+    const vec2 uv12 = (center + w2 / w12) / size;
+    const vec2 uv3 = (center + 2.0) / size;
+
+    vec3 color = sceneTap(vec2(uv0.x, uv0.y)) * w0.x * w0.y
+               + sceneTap(vec2(uv12.x, uv0.y)) * w12.x * w0.y
+               + sceneTap(vec2(uv3.x, uv0.y)) * w3.x * w0.y
+               + sceneTap(vec2(uv0.x, uv12.y)) * w0.x * w12.y
+               + sceneTap(vec2(uv12.x, uv12.y)) * w12.x * w12.y
+               + sceneTap(vec2(uv3.x, uv12.y)) * w3.x * w12.y
+               + sceneTap(vec2(uv0.x, uv3.y)) * w0.x * w3.y
+               + sceneTap(vec2(uv12.x, uv3.y)) * w12.x * w3.y
+               + sceneTap(vec2(uv3.x, uv3.y)) * w3.x * w3.y;
+    // the negative lobes can overshoot below zero next to bright edges
+    return max(color, vec3(0.0));
+}
+
+vec3 sceneColor(vec2 uv)
+{
+    return UPSCALE != 0 ? upscaled(uv) : sceneTap(uv);
+}
+
+// the per-pixel chain: bloom composite, exposure tonemap, gamma and grading
+vec3 graded(vec3 pbrColor, vec2 uv)
+{
+    const float gamma = 2.2;
+    if (BLOOM != 0)
+        pbrColor += texture(bloomBlur, rendered(uv, vec2(textureSize(bloomBlur, 0)))).rgb * 0.1; // additive blending
+    // tone mapping
+    vec3 result = vec3(1.0) - exp(-pbrColor * exposure);
+    // also gamma correct while we're at it
+    result = pow(result, vec3(1.0 / gamma));
+    if (COLOR_GRADING != 0)
+        result = texture(colorGradingLut, result * ((LUT_SIZE - 1.0) / LUT_SIZE) + 0.5 / LUT_SIZE).rgb;
+    return result;
+}
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+vec3 graded(vec2 uv)
+{
+    return graded(sceneTap(uv), uv);
+}
+
+// FXAA in the manner of the 3.11 console variant: four diagonal neighbours find the edge direction,
+// two or four taps along it blend across. It works in scene texels; only the pixel's own color is
+// upscaled, the taps that find and blend along an edge sample bilinear
+vec3 antialiased(vec2 uv)
+{
+    const vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    const vec3 rgbM = graded(sceneColor(uv), uv);
+    const float lumaM = luma(rgbM);
+    const float lumaNW = luma(graded(uv + vec2(-1.0, -1.0) * texel));
+    const float lumaNE = luma(graded(uv + vec2(1.0, -1.0) * texel));
+    const float lumaSW = luma(graded(uv + vec2(-1.0, 1.0) * texel));
+    const float lumaSE = luma(graded(uv + vec2(1.0, 1.0) * texel));
+
+    const float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    const float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    if (lumaMax - lumaMin < max(0.0312, lumaMax * 0.125))
+        return rgbM;
+
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    const float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * (1.0 / 8.0), 1.0 / 128.0);
+    const float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-8.0), vec2(8.0)) * texel;
+
+    const vec3 rgbA = 0.5 * (graded(uv + dir * (1.0 / 3.0 - 0.5)) + graded(uv + dir * (2.0 / 3.0 - 0.5)));
+    const vec3 rgbB = rgbA * 0.5 + 0.25 * (graded(uv - dir * 0.5) + graded(uv + dir * 0.5));
+    const float lumaB = luma(rgbB);
+    return (lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB;
+}
+
+void main()
+{
+    // scene and bloom are read in the corner the scene was rendered to
+    const vec2 uv = TexCoords * uvScale;
+    vec3 color = FXAA != 0 ? antialiased(uv) : graded(sceneColor(uv), uv);
+    if (VIGNETTE != 0)
+    {
+        const vec2 centered = TexCoords - 0.5;
+        color *= 1.0 - vignetteStrength * smoothstep(0.2, 0.8, length(centered) * 1.41421356);
+    }
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 460 core
+
+layout (location = 0) out vec2 TexCoords;
+
+// a triangle covering the screen, no vertex buffer
+void main()
+{
+    const vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
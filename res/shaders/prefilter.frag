@@ -1,9 +1,9 @@
 #version 460 core
 out vec4 FragColor;
-in vec3 localPos;
+layout (location = 0) in vec3 localPos;
 
-uniform samplerCube environmentMap;
-uniform float roughness;
+layout (location = 31) uniform samplerCube environmentMap;
+layout (location = 115) uniform float roughness;
 
 const float PI = 3.14159265359;
 
@@ -2,15 +2,22 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
-out vec3 Normal;
-out vec3 Position;
+layout (location = 0) out vec3 Normal;
+layout (location = 1) out vec3 Position;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+invariant gl_Position; // see object.vert
+
+layout (location = 2) uniform mat4 view;
+layout (location = 1) uniform mat4 projection;
+
+// model matrices of the RenderQueue's draws, each draw's at its gl_BaseInstance
+layout (std430, binding = 12) readonly buffer Transforms {
+    mat4 transforms[];
+};
 
 void main()
 {
+    mat4 model = transforms[gl_BaseInstance];
     Normal = mat3(transpose(inverse(model))) * aNormal;
     Position = vec3(model * vec4(aPos, 1.0));
     gl_Position = projection * view * model * vec4(aPos, 1.0);
@@ -1,11 +1,11 @@
 #version 460 core
 out vec4 FragColor;
 
-in vec3 Normal;
-in vec3 Position;
+layout (location = 0) in vec3 Normal;
+layout (location = 1) in vec3 Position;
 
-uniform vec3 cameraPos;
-uniform samplerCube skybox;
+layout (location = 116) uniform vec3 cameraPos;
+layout (location = 0) uniform samplerCube skybox;
 
 void main()
 {             
@@ -1,14 +1,64 @@
 #version 460 core
-
+// VERTEX_LAYER: the vertex shader sends the vertex to its cascade itself (GL_ARB_shader_viewport_layer_array);
+// otherwise shadowmap.geom passes each triangle through to the cascade in vLayer. Not a specialization
+// constant since it gates an extension, the build compiles it as a separate module instead
+// spirv-variant: VERTEX_LAYER
+#ifdef VERTEX_LAYER
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
 layout (location = 0) in vec3 aPos;
-layout (location = 3) in mat4 instanceMatrix; // Per-instance model matrix
 
-uniform mat4 lightSpaceMatrix;
-uniform mat4 model; // Regular model matrix
-uniform bool useInstanceMatrix; // Flag to indicate instanced rendering
+#ifndef VERTEX_LAYER
+layout (location = 1) flat out int vLayer;
+#endif
+
+// must match CascadedShadowMap::CascadeCount
+const int CASCADE_COUNT = 4;
+
+layout (location = 70) uniform mat4 cascadeMatrices[CASCADE_COUNT];
+// >= 0: the draw was culled for this cascade and goes to it alone; -1: each draw's cascades are the set bits
+// of gl_BaseInstance and instance i goes to the i-th of them (StaticBatch::drawShadowCastersLayered)
+layout (location = 117) uniform int cascade;
+
+layout (location = 11) uniform mat4 model; // Regular model matrix
+layout (location = 12) uniform bool useInstanceMatrix; // Flag to indicate instanced (culled, indirect) rendering
+layout (location = 13) uniform bool useDrawRecords; // StaticBatch multi-draw, the model matrix comes from draws[gl_DrawID]
+
+struct DrawRecord {
+    mat4 model;
+    uint materialID;
+};
+
+layout (std430, binding = 3) readonly buffer DrawRecords {
+    DrawRecord draws[];
+};
+
+// instances culled by InstanceCuller: the survivors of this draw's view start at visible[gl_BaseInstance]
+layout (std430, binding = 4) readonly buffer Instances {
+    mat4 instances[];
+};
+
+layout (std430, binding = 5) readonly buffer VisibleInstances {
+    uint visible[];
+};
 
 void main()
 {
-    mat4 finalModel = useInstanceMatrix ? instanceMatrix : model;
-    gl_Position = lightSpaceMatrix * finalModel * vec4(aPos, 1.0);
+    mat4 finalModel = useDrawRecords ? draws[gl_DrawID].model : (useInstanceMatrix ? instances[visible[gl_BaseInstance + gl_InstanceID]] : model);
+
+    int layer = cascade;
+    if (layer < 0)
+    {
+        uint cascades = uint(gl_BaseInstance);
+        for (int i = 0; i < gl_InstanceID; ++i)
+            cascades &= cascades - 1u; // drop the lowest cascade
+        layer = findLSB(cascades);
+    }
+
+    gl_Position = cascadeMatrices[layer] * finalModel * vec4(aPos, 1.0);
+#ifdef VERTEX_LAYER
+    gl_Layer = layer;
+#else
+    vLayer = layer;
+#endif
 }
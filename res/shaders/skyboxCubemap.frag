@@ -1,8 +1,8 @@
 #version 460 core
 out  vec4 FragColor;
-in vec3 localPos;
+layout (location = 0) in vec3 localPos;
 
-uniform sampler2D equirectangularMap;
+layout (location = 118) uniform sampler2D equirectangularMap;
 
 const vec2 invAtan = vec2(0.1591, 0.3183);
 vec2 SampleSphericalMap(vec3 v)
@@ -1,11 +1,11 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
 
-out vec3 localPos;
-out vec3 WorldPos;
+layout (location = 0) out vec3 localPos;
+layout (location = 1) out vec3 WorldPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (location = 1) uniform mat4 projection;
+layout (location = 2) uniform mat4 view;
 
 void main()
 {
@@ -0,0 +1,46 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+#include <limits>
+
+// Axis aligned bounding box; a default constructed one is empty (min > max) and grows with expand()
+struct AABB
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    void expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    bool empty() const { return min.x > max.x; }
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+
+    // box around the transformed box (Arvo): each output axis sums the extremes of every input axis
+    AABB transformed(const glm::mat4& matrix) const
+    {
+        if (empty())
+            return *this;
+        AABB result;
+        result.min = result.max = glm::vec3(matrix[3]);
+        for (int column = 0; column < 3; column++)
+        {
+            const glm::vec3 a = glm::vec3(matrix[column]) * min[column];
+            const glm::vec3 b = glm::vec3(matrix[column]) * max[column];
+            result.min += glm::min(a, b);
+            result.max += glm::max(a, b);
+        }
+        return result;
+    }
+};
+#endif
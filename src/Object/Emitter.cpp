@@ -111,14 +111,14 @@ ParticleEmitter::ParticleEmitter()
 
     if (data)
     {
-        glGenTextures(1, &sprite);
-        glBindTexture(GL_TEXTURE_2D, sprite);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glCreateTextures(GL_TEXTURE_2D, 1, &sprite);
+        glTextureStorage2D(sprite, 1, GL_RGBA8, width, height);
+        glTextureSubImage2D(sprite, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+        glTextureParameteri(sprite, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(sprite, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(sprite, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(sprite, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         stbi_image_free(data);
     }
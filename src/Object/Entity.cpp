@@ -103,3 +103,31 @@ void Entity::Draw(Shader& shader)
     /*for (auto& child : children)
         child->Draw(shader);*/
 }
+
+void Entity::DrawDepth(Shader& shader)
+{
+    if (this->transform.isDirty())
+        forceUpdateSelfAndChild();
+    shader.setMat4("model", transform.getModelMatrix());
+    for (Mesh& mesh : meshes)
+        mesh.DrawDepth(shader);
+}
+
+AABB Entity::worldBounds()
+{
+    if (this->transform.isDirty())
+        forceUpdateSelfAndChild();
+    AABB bounds;
+    for (const Mesh& mesh : meshes)
+        bounds.expand(mesh.bounds.transformed(transform.getModelMatrix()));
+    return bounds;
+}
+
+void Entity::submit(RenderQueue& queue, uint8_t pass, Shader& shader, const Camera& camera)
+{
+    if (this->transform.isDirty())
+        forceUpdateSelfAndChild();
+    const glm::mat4& model = transform.getModelMatrix();
+    const float depth = glm::dot(glm::vec3(model[3]) - camera.Position, camera.Front);
+    Model::submit(queue, pass, shader, model, depth);
+}
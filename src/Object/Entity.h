@@ -75,5 +75,14 @@ public:
     //Force update of transform even if local space don't change
     void forceUpdateSelfAndChild();
     void Draw(Shader& shader) override;
+
+    // the entity's meshes into depth-only passes, through their position streams
+    void DrawDepth(Shader& shader);
+
+    // bounds of the entity's own meshes (not its children) under its current model matrix
+    AABB worldBounds();
+
+    // queues the entity's meshes, ordered by distance along the camera's view direction
+    void submit(RenderQueue& queue, uint8_t pass, Shader& shader, const Camera& camera);
 };
 #endif
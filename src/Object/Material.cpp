@@ -0,0 +1,67 @@
+#include "Material.h"
+#include "Renderer/GLState.h"
+#include "Renderer/MaterialTable.h"
+#include "Renderer/TextureUnits.h"
+
+namespace
+{
+    const char* samplerNames[MATERIAL_MAP_COUNT] = {
+        "material.albedoMap",
+        "material.aoMap",
+        "material.metallicMap",
+        "material.normalMap",
+        "material.roughnessMap"
+    };
+
+    // white albedo, full ao, non-metallic, flat tangent-space normal, fully rough
+    const unsigned char defaultTexels[MATERIAL_MAP_COUNT][4] = {
+        { 255, 255, 255, 255 },
+        { 255, 255, 255, 255 },
+        {   0,   0,   0, 255 },
+        { 128, 128, 255, 255 },
+        { 255, 255, 255, 255 }
+    };
+}
+
+Material::Material()
+{
+    for (int map = 0; map < MATERIAL_MAP_COUNT; map++)
+        textures[map] = defaultTexture(static_cast<MaterialMap>(map));
+}
+
+void Material::setMap(MaterialMap map, GLuint texture)
+{
+    textures[map] = texture;
+}
+
+void Material::bind() const
+{
+    for (GLuint map = 0; map < MATERIAL_MAP_COUNT; map++)
+        GLState::bindTexture(TextureUnit::MaterialMaps + map, textures[map]);
+}
+
+void Material::apply(const Shader& shader) const
+{
+    if (MaterialTable::mode() != MaterialTable::Discrete && shader.materialIDLocation >= 0)
+        glVertexAttribI1ui(shader.materialIDLocation, id);
+    else
+        bind();
+}
+
+void Material::assignSamplerUnits(Shader& shader)
+{
+    for (int map = 0; map < MATERIAL_MAP_COUNT; map++)
+        shader.setInt(samplerNames[map], TextureUnit::MaterialMaps + map);
+}
+
+GLuint Material::defaultTexture(MaterialMap map)
+{
+    static std::array<GLuint, MATERIAL_MAP_COUNT> defaults = {};
+    if (defaults[map] == 0)
+    {
+        glCreateTextures(GL_TEXTURE_2D, 1, &defaults[map]);
+        glTextureStorage2D(defaults[map], 1, GL_RGBA8, 1, 1);
+        glTextureSubImage2D(defaults[map], 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, defaultTexels[map]);
+    }
+    return defaults[map];
+}
@@ -0,0 +1,46 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+
+#include <array>
+
+// PBR maps of a material; each is bound to texture unit TextureUnit::MaterialMaps + its value
+enum MaterialMap {
+    MATERIAL_ALBEDO,
+    MATERIAL_AO,
+    MATERIAL_METALLIC,
+    MATERIAL_NORMAL,
+    MATERIAL_ROUGHNESS,
+    MATERIAL_MAP_COUNT
+};
+
+// A set of PBR textures resolved once at load time. Every map lives on a fixed texture unit, so binding
+// a material is a handful of integer binds and the sampler uniforms only have to be set once per program.
+class Material {
+public:
+    std::array<GLuint, MATERIAL_MAP_COUNT> textures;
+    GLuint id = 0; // record in the MaterialTable
+
+    // every map starts out as a 1x1 neutral texture, so a material missing some maps still samples sensibly
+    Material();
+
+    void setMap(MaterialMap map, GLuint texture);
+
+    // bind all maps to their units
+    void bind() const;
+
+    // select this material for the next draw with shader: if the shader reads the MaterialTable, the ID
+    // becomes the current value of its material ID attribute (used wherever the VAO has no per-vertex IDs),
+    // otherwise bind()
+    void apply(const Shader& shader) const;
+
+    // point the material.*Map sampler uniforms of the shader at the fixed units; call once after creating a program
+    static void assignSamplerUnits(Shader& shader);
+
+private:
+    static GLuint defaultTexture(MaterialMap map);
+};
+#endif
@@ -1,110 +1,91 @@
 #include "Mesh.h"
-#include <unordered_map>
-Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+#include "Renderer/GLState.h"
+Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, unsigned int materialIndex)
 {
     this->vertices = vertices;
     this->indices = indices;
-    this->textures = textures;
+    this->materialIndex = materialIndex;
+    indexCount = static_cast<GLsizei>(indices.size());
+    for (const Vertex& vertex : this->vertices)
+        bounds.expand(vertex.Position);
 
     // now that we have all the required data, set the vertex buffers and its attribute pointers.
     setupMesh();
+    setupPositionStream();
     }
 
-void Mesh::Draw(Shader& shader)
+void Mesh::Draw(Shader& shader, const Material& material)
 {
     shader.use();
+    material.apply(shader);
 
-    std::unordered_map<std::string, std::string> textureTypeToUniform = {
-    {"texture_albedo", "material.albedoMap"},
-    {"texture_metallic", "material.metallicMap"},
-    {"texture_roughness", "material.roughnessMap"},
-    {"texture_normal", "material.normalMap"},
-    {"texture_ao", "material.aoMap"}
-    };
-
-    unsigned int albedoNr = 1;
-    unsigned int metallicNr = 1;
-    unsigned int roughnessNr = 1;
-    unsigned int normalNr = 1;
-    unsigned int aoNr = 1;
-
-    for (unsigned int i = 0; i < textures.size(); i++)
-    {
-        glActiveTexture(GL_TEXTURE0 + i); // Activate texture unit
-
-        std::string number;
-        std::string name = textures[i].type;
-
-        if (name == "texture_albedo")
-            number = std::to_string(albedoNr++);
-        else if (name == "texture_metallic")
-            number = std::to_string(metallicNr++);
-        else if (name == "texture_roughness")
-            number = std::to_string(roughnessNr++);
-        else if (name == "texture_normal")
-            number = std::to_string(normalNr++);
-        else if (name == "texture_ao")
-            number = std::to_string(aoNr++);
-
-        // Set the uniform sampler for the texture
-
-        std::string uniformName = textureTypeToUniform[name];
-        GLint uniformLocation = glGetUniformLocation(shader.ID, uniformName.c_str());
-
-        glUniform1i(uniformLocation, i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
-    }
-
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    // the VAO stays bound so consecutive draws of the same mesh skip the rebind
+    GLState::bindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+}
 
-    // Reset texture unit
-    glActiveTexture(GL_TEXTURE0);
+void Mesh::DrawDepth(Shader& shader)
+{
+    shader.use();
+    GLState::bindVertexArray(positionVAO);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
 }
 
 void Mesh::setupMesh()
 {
     // create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    // load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glCreateBuffers(1, &VBO);
+    glCreateBuffers(1, &EBO);
     // A great thing about structs is that their memory layout is sequential for all its items.
     // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
     // again translates to 3/2 floats which translates to a byte array.
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-    // set the vertex attribute pointers
+    glNamedBufferStorage(VBO, vertices.size() * sizeof(Vertex), vertices.data(), 0);
+    glNamedBufferStorage(EBO, indices.size() * sizeof(unsigned int), indices.data(), 0);
+
+    // one interleaved binding, every attribute at its offset in Vertex
+    glCreateVertexArrays(1, &VAO);
+    glVertexArrayVertexBuffer(VAO, 0, VBO, 0, sizeof(Vertex));
+    glVertexArrayElementBuffer(VAO, EBO);
+    const auto attribute = [this](GLuint index, GLint size, GLenum type, GLuint offset)
+    {
+        glEnableVertexArrayAttrib(VAO, index);
+        if (type == GL_INT)
+            glVertexArrayAttribIFormat(VAO, index, size, type, offset);
+        else
+            glVertexArrayAttribFormat(VAO, index, size, type, GL_FALSE, offset);
+        glVertexArrayAttribBinding(VAO, index, 0);
+    };
     // vertex Positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    attribute(0, 3, GL_FLOAT, offsetof(Vertex, Position));
     // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    attribute(1, 3, GL_FLOAT, offsetof(Vertex, Normal));
     // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    attribute(2, 2, GL_FLOAT, offsetof(Vertex, TexCoords));
     // vertex tangent
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+    attribute(3, 3, GL_FLOAT, offsetof(Vertex, Tangent));
     // vertex bitangent
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+    attribute(4, 3, GL_FLOAT, offsetof(Vertex, Bitangent));
     // ids
-    glEnableVertexAttribArray(5);
-    glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
+    attribute(5, 4, GL_INT, offsetof(Vertex, m_BoneIDs));
     // weights
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-    glBindVertexArray(0);
+    attribute(6, 4, GL_FLOAT, offsetof(Vertex, m_Weights));
 }
 
+void Mesh::setupPositionStream()
+{
+    // 12 bytes a vertex instead of sizeof(Vertex)
+    vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& vertex : vertices)
+        positions.push_back(vertex.Position);
+
+    glCreateBuffers(1, &positionVBO);
+    glNamedBufferStorage(positionVBO, positions.size() * sizeof(glm::vec3), positions.data(), 0);
+
+    glCreateVertexArrays(1, &positionVAO);
+    glVertexArrayVertexBuffer(positionVAO, 0, positionVBO, 0, sizeof(glm::vec3));
+    glVertexArrayElementBuffer(positionVAO, EBO);
+    glEnableVertexArrayAttrib(positionVAO, 0);
+    glVertexArrayAttribFormat(positionVAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(positionVAO, 0, 0);
+}
@@ -6,7 +6,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "AABB.h"
 #include "Shader.h"
+#include "Material.h"
 
 #include <string>
 #include <vector>
@@ -42,22 +44,32 @@ public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
-    vector<Texture>      textures;
+    unsigned int materialIndex; // into the owning Model's materials
+    AABB bounds; // model space, computed at import
     unsigned int VAO;
+    // for depth-only passes: attribute 0 alone, from a tightly packed copy of the positions, same indices
+    unsigned int positionVAO;
 
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures);
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, unsigned int materialIndex);
 
     // render the mesh
-    void Draw(Shader& shader);
+    void Draw(Shader& shader, const Material& material);
+
+    // render the mesh's depth through the position stream, no material
+    void DrawDepth(Shader& shader);
+
+    GLsizei getIndexCount() const { return indexCount; }
     
 
 private:
     // render data 
-    unsigned int VBO, EBO;
+    unsigned int VBO, EBO, positionVBO;
+    GLsizei indexCount;
 
     // initializes all the buffer objects/arrays
     void setupMesh();
+    void setupPositionStream();
     
 };
 #endif
@@ -1,4 +1,7 @@
 #include "Model.h"
+#include "Renderer/GLState.h"
+#include "Renderer/MaterialTable.h"
+#include "Renderer/RenderQueue.h"
 #include "assimp/Logger.hpp"
 #include "assimp/DefaultLogger.hpp"
 Model::Model(string const& path, bool gamma) : gammaCorrection(gamma)
@@ -9,10 +12,18 @@ Model::Model(string const& path, bool gamma) : gammaCorrection(gamma)
 void Model::Draw(Shader& shader)
 {
     for (unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
+        meshes[i].Draw(shader, materials[meshes[i].materialIndex]);
+}
+
+void Model::submit(RenderQueue& queue, uint8_t pass, Shader& shader, const glm::mat4& model, float depth)
+{
+    for (const Mesh& mesh : meshes)
+        queue.submit(pass, shader, &materials[mesh.materialIndex], mesh.VAO, mesh.getIndexCount(), 1, &model, depth);
 }
 
 #include <filesystem>
+#include <algorithm>
+#include <cmath>
 void Model::loadModel(string const& path)
 {
     Assimp::DefaultLogger::create("", Assimp::Logger::VERBOSE);
@@ -56,7 +67,6 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
 {
     vector<Vertex> vertices;
     vector<unsigned int> indices;
-    vector<Texture> textures;
 
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
@@ -130,47 +140,47 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     //textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
 
+    return Mesh(vertices, indices, loadDirectoryMaterial());
+}
+
+unsigned int Model::loadDirectoryMaterial()
+{
+    if (directoryMaterial >= 0)
+        return directoryMaterial;
+
+    static const std::pair<const char*, MaterialMap> suffixes[] = {
+        { "_albedo.png",    MATERIAL_ALBEDO },
+        { "_ao.png",        MATERIAL_AO },
+        { "_metallic.png",  MATERIAL_METALLIC },
+        { "_normal.png",    MATERIAL_NORMAL },
+        { "_roughness.png", MATERIAL_ROUGHNESS }
+    };
+
     // dynamic loading 
-    const std::string modelDir = directory;
-    for (auto& entry : std::filesystem::directory_iterator(modelDir))
+    Material material;
+    for (auto& entry : std::filesystem::directory_iterator(directory))
     {
-        const std::string filePath = entry.path().string();
         std::string fileName = entry.path().filename().string();
 
-        Texture texture;
-        if (ends_with(fileName, "_albedo.png")) {
-            texture.type = "texture_albedo";
-            texture.path = filePath;  // Correct path assignment
-        }
-        else if (ends_with(fileName, "_metallic.png")) {
-            texture.type = "texture_metallic";
-            texture.path = filePath;  // Correct path assignment
-        }
-        else if (ends_with(fileName, "_roughness.png")) {
-            texture.type = "texture_roughness";
-            texture.path = filePath;  // Correct path assignment
-        }
-        else if (ends_with(fileName, "_normal.png")) {
-            texture.type = "texture_normal";
-            texture.path = filePath;  // Correct path assignment
-        }
-        else if (ends_with(fileName, "_ao.png")) {
-            texture.type = "texture_ao";
-            texture.path = filePath;  // Correct path assignment
+        bool relevant = false;
+        for (const auto& [suffix, map] : suffixes)
+        {
+            if (ends_with(fileName, suffix))
+            {
+                if (unsigned int texture = TextureFromFile(fileName.c_str(), directory))
+                    material.setMap(map, texture);
+                relevant = true;
+                break;
+            }
         }
-        else {
+        if (!relevant)
             std::cout << "[Model texture loading] skipping loading texture from: " << entry << '\n';
-            continue;  // Skip non-relevant textures
-        }
-        texture.id = TextureFromFile(fileName.c_str(), directory);
-
-        // Create texture object (you would normally load the texture here)
-        textures.push_back(std::move(texture));
     }
-    
-
 
-    return Mesh(vertices, indices, textures);
+    material.id = MaterialTable::add(material);
+    materials.push_back(material);
+    directoryMaterial = static_cast<int>(materials.size() - 1);
+    return directoryMaterial;
 }
 
 vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
@@ -209,38 +219,50 @@ unsigned int TextureFromFile(const char* path, const string& directory, bool gam
     filename = directory + '/' + filename;
 
     unsigned int textureID;
-    glGenTextures(1, &textureID);
+    glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
 
     int width, height, nrComponents;
     unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format;
+        GLenum internalFormat;
         if (nrComponents == 1)
+        {
             format = GL_RED;
+            internalFormat = GL_R8;
+        }
         else if (nrComponents == 3)
+        {
             format = GL_RGB;
-        else if (nrComponents == 4)
+            internalFormat = GL_RGB8;
+        }
+        else
+        {
             format = GL_RGBA;
+            internalFormat = GL_RGBA8;
+        }
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        GLState::enable(GL_BLEND);
+        GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // DSA upload, the texture is never bound here so the state cache stays valid
+        const GLsizei levels = 1 + static_cast<GLsizei>(std::floor(std::log2(std::max(width, height))));
+        glTextureStorage2D(textureID, levels, internalFormat, width, height);
+        glTextureSubImage2D(textureID, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, data);
+        glGenerateTextureMipmap(textureID);
         if (nrComponents == 4) {
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         }
         else
         {
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         }
 
         stbi_image_free(data);
@@ -249,6 +271,8 @@ unsigned int TextureFromFile(const char* path, const string& directory, bool gam
     {
         std::cout << "Texture failed to load at path: " << path << std::endl;
         stbi_image_free(data);
+        glDeleteTextures(1, &textureID);
+        textureID = 0;
     }
 
     return textureID;
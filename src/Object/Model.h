@@ -21,6 +21,8 @@
 #include <vector>
 using namespace std;
 
+class RenderQueue;
+
 unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
 
 class Model
@@ -29,6 +31,7 @@ public:
     // model data 
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    vector<Material> materials; // indexed by Mesh::materialIndex
     string directory;
     bool gammaCorrection;
 
@@ -38,6 +41,9 @@ public:
 
     // draws the model, and thus all its meshes
     virtual void Draw(Shader& shader);
+
+    // queues a packet per mesh instead of drawing right away
+    void submit(RenderQueue& queue, uint8_t pass, Shader& shader, const glm::mat4& model, float depth);
     
 
 private:
@@ -50,6 +56,11 @@ private:
 
     Mesh processMesh(aiMesh* mesh, const aiScene* scene);
 
+    // builds the material from the *_albedo/_ao/_metallic/_normal/_roughness.png maps next to the model,
+    // once per model; returns its index in materials
+    unsigned int loadDirectoryMaterial();
+    int directoryMaterial = -1;
+
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
     // the required info is returned as a Texture struct.
     vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName);
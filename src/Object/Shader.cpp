@@ -1,191 +1,390 @@
 #include "Shader.h"
+#include "Renderer/GLState.h"
 #include <glm/gtc/type_ptr.hpp>
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const char* computePath)
-{
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
-    std::string computeCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    std::ifstream gShaderFile;
-    std::ifstream cShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try
-    {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-        // if geometry shader path is present, also load a geometry shader
-        if (geometryPath != nullptr)
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <regex>
+
+namespace
+{
+    unsigned int spirvPrograms = 0;
+    unsigned int sourcePrograms = 0;
+
+    std::string readShaderFile(const char* path, std::ios::openmode mode = std::ios::in)
+    {
+        std::ifstream file;
+        // ensure ifstream objects can throw exceptions:
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
         {
-            gShaderFile.open(geometryPath);
-            std::stringstream gShaderStream;
-            gShaderStream << gShaderFile.rdbuf();
-            gShaderFile.close();
-            geometryCode = gShaderStream.str();
+            file.open(path, mode);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
         }
-        if (computePath != nullptr)
+        catch (std::ifstream::failure& e)
         {
-            cShaderFile.open(computePath);
-            std::stringstream cShaderStream;
-            cShaderStream << cShaderFile.rdbuf();
-            cShaderFile.close();
-            computeCode = cShaderStream.str();
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << " " << e.what() << std::endl;
         }
+        return {};
     }
-    catch (std::ifstream::failure& e)
-    {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-    }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-    // 2. compile shaders
-    unsigned int vertex, fragment;
-    // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
-    // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
-    // if geometry shader is given, compile geometry shader
-    unsigned int geometry;
-    if (geometryPath != nullptr)
+
+    // the build writes res/shaders/object.frag to spirv/object.frag.spv next to the executable, and its
+    // "// spirv-variant: NAME" defines to spirv/object.frag.NAME.spv
+    std::string spirvPathFor(const char* sourcePath, const std::string& variant = {})
     {
-        const char* gShaderCode = geometryCode.c_str();
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkCompileErrors(geometry, "GEOMETRY");
+        const std::string file = std::filesystem::path(sourcePath).filename().string();
+        return "spirv/" + file + (variant.empty() ? "" : "." + variant) + ".spv";
     }
-    unsigned int compute;
-    if (computePath != nullptr)
+
+    // "object.vert + object.frag" for the log
+    template<typename Stages>
+    std::string programName(const Stages& stages)
     {
-        const char* cShaderCode = computeCode.c_str();
-        compute = glCreateShader(GL_COMPUTE_SHADER);
-        glShaderSource(compute, 1, &cShaderCode, NULL);
-        glCompileShader(compute);
-        checkCompileErrors(compute, "COMPUTE");
+        std::string name;
+        for (const auto& stage : stages)
+            name += (name.empty() ? "" : " + ") + std::filesystem::path(stage.path).filename().string();
+        return name;
     }
 
-    // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    if (geometryPath != nullptr)
-        glAttachShader(ID, geometry);
-    if (computePath != nullptr) {
-        glAttachShader(ID, compute);
+    // array sizes are literals or a "const int" / #define in the same source
+    int arraySize(const std::string& source, const std::string& size)
+    {
+        if (std::all_of(size.begin(), size.end(), [](unsigned char c) { return std::isdigit(c); }))
+            return std::stoi(size);
+        std::smatch match;
+        const std::regex constant("(?:const\\s+int\\s+" + size + "\\s*=|#define\\s+" + size + ")\\s*(\\d+)");
+        return std::regex_search(source, match, constant) ? std::stoi(match[1]) : 1;
     }
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
-    // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+
+    bool spirvSupported()
+    {
+        static const bool supported = []()
+        {
+            if (!GLAD_GL_VERSION_4_6)
+                return false;
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_SHADER_BINARY_FORMATS, &count);
+            std::vector<GLint> formats(count);
+            if (count > 0)
+                glGetIntegerv(GL_SHADER_BINARY_FORMATS, formats.data());
+            for (GLint format : formats)
+                if (format == GL_SHADER_BINARY_FORMAT_SPIR_V)
+                    return true;
+            return false;
+        }();
+        return supported;
+    }
+
+    // glSpecializeShader fails on constant ids the module doesn't declare, so collect the SpecId decorations
+    bool declaresSpecConstant(const std::string& module, GLuint specId)
+    {
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(module.data());
+        const size_t wordCount = module.size() / sizeof(uint32_t);
+        const uint32_t OpDecorate = 71, DecorationSpecId = 1;
+
+        // skip the 5 word header, then walk the instruction stream
+        for (size_t i = 5; i < wordCount;)
+        {
+            const uint32_t length = words[i] >> 16;
+            const uint32_t opcode = words[i] & 0xFFFF;
+            if (length == 0)
+                break;
+            if (opcode == OpDecorate && length >= 4 && i + 3 < wordCount && words[i + 2] == DecorationSpecId && words[i + 3] == specId)
+                return true;
+            i += length;
+        }
+        return false;
+    }
+
+    // #defines go right after #version; the #line keeps compiler messages pointing at the file's own lines
+    std::string injectDefines(const std::string& code, const std::vector<SpecializationConstant>& constants)
+    {
+        if (constants.empty())
+            return code;
+
+        std::string defines;
+        for (const auto& constant : constants)
+            defines += "#define " + constant.name + " " + std::to_string(constant.value) + "\n";
+
+        const size_t version = code.find("#version");
+        if (version == std::string::npos)
+            return defines + "#line 1\n" + code;
+
+        const size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return code + "\n" + defines;
+
+        const size_t versionLine = std::count(code.begin(), code.begin() + lineEnd, '\n') + 1;
+        return code.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(versionLine + 1) + "\n" + code.substr(lineEnd + 1);
+    }
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const char* computePath,
+               const std::vector<SpecializationConstant>& constants)
+{
+    std::vector<ShaderStage> stages = {
+        { vertexPath,   GL_VERTEX_SHADER,   "VERTEX" },
+        { fragmentPath, GL_FRAGMENT_SHADER, "FRAGMENT" }
+    };
+    // if geometry shader path is present, also load a geometry shader
     if (geometryPath != nullptr)
-        glDeleteShader(geometry);
+        stages.push_back({ geometryPath, GL_GEOMETRY_SHADER, "GEOMETRY" });
+    if (computePath != nullptr)
+        stages.push_back({ computePath, GL_COMPUTE_SHADER, "COMPUTE" });
+
+    build(stages, constants);
+}
+
+
+Shader::Shader(const char* computePath, const std::vector<SpecializationConstant>& constants)
+{
+    build({ { computePath, GL_COMPUTE_SHADER, "COMPUTE" } }, constants);
+}
+
+void Shader::build(const std::vector<ShaderStage>& stages, const std::vector<SpecializationConstant>& constants)
+{
+    std::vector<std::string> sources;
+    for (const auto& stage : stages)
+    {
+        sources.push_back(readShaderFile(stage.path));
+        collectUniformLocations(sources.back());
+    }
+
+    std::string reason;
+    if (buildFromSpirv(stages, constants, reason))
+    {
+        spirvPrograms++;
+        spdlog::info("[Shader] {}: SPIR-V", programName(stages));
+    }
+    else
+    {
+        buildFromSource(stages, sources, constants);
+        sourcePrograms++;
+        spdlog::info("[Shader] {}: GLSL source, {}", programName(stages), reason);
+    }
+
+    // the vertex input is declared with its location as well
+    std::smatch match;
+    static const std::regex materialID("layout\\s*\\(\\s*location\\s*=\\s*(\\d+)\\s*\\)\\s*in\\s+\\w+\\s+aMaterialID\\b");
+    if (stages.front().type == GL_VERTEX_SHADER && std::regex_search(sources.front(), match, materialID))
+        materialIDLocation = std::stoi(match[1]);
 }
 
+void Shader::collectUniformLocations(const std::string& source)
+{
+    // struct name -> member names, one location each
+    std::unordered_map<std::string, std::vector<std::string>> structs;
+    static const std::regex structDecl("struct\\s+(\\w+)\\s*\\{([^}]*)\\}");
+    static const std::regex member("(\\w+)\\s*(?=,|;)");
+    for (std::sregex_iterator it(source.begin(), source.end(), structDecl), end; it != end; ++it)
+    {
+        // drop the comments, then every name followed by , or ; is a member
+        const std::string body = std::regex_replace((*it)[2].str(), std::regex("//[^\\n]*"), "");
+        auto& members = structs[(*it)[1]];
+        for (std::sregex_iterator m(body.begin(), body.end(), member), mend; m != mend; ++m)
+            members.push_back((*m)[1]);
+    }
+
+    static const std::regex uniformDecl("layout\\s*\\(([^)]*)\\)\\s*uniform\\s+(\\w+)\\s+(\\w+)\\s*(?:\\[\\s*(\\w+)\\s*\\])?\\s*;");
+    static const std::regex locationQualifier("location\\s*=\\s*(\\d+)");
+    for (std::sregex_iterator it(source.begin(), source.end(), uniformDecl), end; it != end; ++it)
+    {
+        std::smatch location;
+        const std::string qualifiers = (*it)[1];
+        if (!std::regex_search(qualifiers, location, locationQualifier))
+            continue;
+        const GLint base = std::stoi(location[1]);
+        const std::string name = (*it)[3];
+        uniformLocations[name] = base;
 
-Shader::Shader(const char* computePath)
+        if ((*it)[4].matched)
+        {
+            const int size = arraySize(source, (*it)[4]);
+            for (int i = 0; i < size; i++)
+                uniformLocations[name + "[" + std::to_string(i) + "]"] = base + i;
+        }
+        else if (auto type = structs.find((*it)[2]); type != structs.end())
+        {
+            for (size_t i = 0; i < type->second.size(); i++)
+                uniformLocations[name + "." + type->second[i]] = base + static_cast<GLint>(i);
+        }
+    }
+}
+
+bool Shader::buildFromSpirv(const std::vector<ShaderStage>& stages, const std::vector<SpecializationConstant>& constants, std::string& reason)
 {
-    std::string computeCode;
-    std::ifstream cShaderFile;
-    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    if (!spirvSupported())
+    {
+        reason = "the driver has no SPIR-V support";
+        return false;
+    }
+
+    // a program can't mix SPIR-V and GLSL stages, so every module has to be there
+    std::vector<std::string> modules;
+    for (const auto& stage : stages)
+    {
+        const std::string path = spirvPathFor(stage.path);
+        std::string module;
+        if (std::filesystem::exists(path))
+            module = readShaderFile(path.c_str(), std::ios::in | std::ios::binary);
+        if (module.empty())
+        {
+            reason = path + " was not built";
+            return false;
+        }
+        modules.push_back(std::move(module));
+    }
+
+    // a constant no module declares only exists as a #define in the source (e.g. features behind GLSL
+    // extensions); the stage that has a variant module compiled with it defined uses that instead
+    std::vector<std::string> variants(stages.size());
+    for (const auto& constant : constants)
+    {
+        const bool declared = std::any_of(modules.begin(), modules.end(),
+                                          [&](const std::string& module) { return declaresSpecConstant(module, constant.index); });
+        if (declared)
+            continue;
 
-    try {
-        cShaderFile.open(computePath);
-        std::stringstream cShaderStream;
-        cShaderStream << cShaderFile.rdbuf();
-        cShaderFile.close();
-        computeCode = cShaderStream.str();
+        bool found = false;
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            const std::string path = spirvPathFor(stages[i].path, constant.name);
+            if (!variants[i].empty() || !std::filesystem::exists(path))
+                continue;
+            modules[i] = readShaderFile(path.c_str(), std::ios::in | std::ios::binary);
+            variants[i] = constant.name;
+            found = true;
+        }
+        if (!found)
+        {
+            reason = constant.name + " has no SPIR-V constant or variant";
+            return false;
+        }
     }
-    catch (std::ifstream::failure& e)
+
+    bool success = true;
+    std::vector<unsigned int> shaders;
+    ID = glCreateProgram();
+    for (size_t i = 0; i < stages.size(); i++)
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        std::vector<GLuint> indices, values;
+        for (const auto& constant : constants)
+        {
+            if (!declaresSpecConstant(modules[i], constant.index))
+                continue;
+            indices.push_back(constant.index);
+            values.push_back(constant.value);
+        }
+
+        unsigned int shader = glCreateShader(stages[i].type);
+        glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, modules[i].data(), static_cast<GLsizei>(modules[i].size()));
+        glSpecializeShader(shader, "main", static_cast<GLuint>(indices.size()), indices.data(), values.data());
+        success &= checkCompileErrors(shader, stages[i].typeName);
+        glAttachShader(ID, shader);
+        shaders.push_back(shader);
     }
+    glLinkProgram(ID);
+    success &= checkCompileErrors(ID, "PROGRAM");
+    for (unsigned int shader : shaders)
+        glDeleteShader(shader);
 
-    unsigned int compute;
-    
-        const char* cShaderCode = computeCode.c_str();
-        compute = glCreateShader(GL_COMPUTE_SHADER);
-        glShaderSource(compute, 1, &cShaderCode, NULL);
-        glCompileShader(compute);
-        checkCompileErrors(compute, "COMPUTE");
-    
+    if (!success)
+    {
+        reason = "the SPIR-V modules failed to link";
+        glDeleteProgram(ID);
+        ID = 0;
+    }
+    return success;
+}
 
+void Shader::buildFromSource(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources,
+                             const std::vector<SpecializationConstant>& constants)
+{
+    std::vector<unsigned int> shaders;
     ID = glCreateProgram();
-        glAttachShader(ID, compute);
-    
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        const std::string code = injectDefines(sources[i], constants);
+        const char* shaderCode = code.c_str();
+
+        unsigned int shader = glCreateShader(stages[i].type);
+        glShaderSource(shader, 1, &shaderCode, NULL);
+        glCompileShader(shader);
+        checkCompileErrors(shader, stages[i].typeName);
+        glAttachShader(ID, shader);
+        shaders.push_back(shader);
+    }
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
     // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(compute);
+    for (unsigned int shader : shaders)
+        glDeleteShader(shader);
 }
+
 void Shader::use()
 {
-    glUseProgram(ID);
+    GLState::useProgram(ID);
+}
+
+GLint Shader::uniformLocation(const std::string& name) const
+{
+    const auto location = uniformLocations.find(name);
+    if (location != uniformLocations.end())
+        return location->second;
+    return uniformLocations[name] = glGetUniformLocation(ID, name.c_str());
+}
+
+unsigned int Shader::spirvProgramCount()
+{
+    return spirvPrograms;
+}
+
+unsigned int Shader::sourceProgramCount()
+{
+    return sourcePrograms;
 }
 
+// the setters write through glProgramUniform so they never have to bind the program
 void Shader::setBool(const std::string& name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glProgramUniform1i(ID, uniformLocation(name), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glProgramUniform1i(ID, uniformLocation(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glProgramUniform1f(ID, uniformLocation(name), value);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& value)
 {
-    glUseProgram(ID);
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1,GL_FALSE, glm::value_ptr(value));
+    glProgramUniformMatrix4fv(ID, uniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value)
 {
-    glUseProgram(ID);
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    glProgramUniform4fv(ID, uniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value)
 {
-    glUseProgram(ID);
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    glProgramUniform3fv(ID, uniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2 value)
 {
-    glUseProgram(ID);
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    glProgramUniform2fv(ID, uniformLocation(name), 1, glm::value_ptr(value));
 }
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type)
+bool Shader::checkCompileErrors(unsigned int shader, std::string type)
 {
     int success;
     char infoLog[1024];
@@ -207,4 +406,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success;
 }
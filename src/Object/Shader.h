@@ -4,43 +4,86 @@
 #include <glad/glad.h>
 
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <glm/glm.hpp>
 
+// A specialization constant is fed to glSpecializeShader when the program is loaded from the
+// precompiled SPIR-V modules, and injected as "#define name value" when it is built from GLSL source.
+struct SpecializationConstant
+{
+    GLuint      index; // constant_id in the shader
+    GLuint      value;
+    std::string name;
+};
+
 class Shader
 {
 public:
     unsigned int ID;
+    // location of the aMaterialID vertex input of shaders reading the MaterialTable, -1 otherwise
+    GLint materialIDLocation = -1;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char* computePath = nullptr);
-    
-    Shader(const char* computePath);
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const char* computePath = nullptr,
+           const std::vector<SpecializationConstant>& constants = {});
+
+    Shader(const char* computePath, const std::vector<SpecializationConstant>& constants = {});
 
     // activate the shader
     // ------------------------------------------------------------------------
     void use();
-    
+
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const;
-    
+
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const;
-    
+
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const;
-    
+
     void setMat4(const std::string& name, const glm::mat4& value);
     void setVec4(const std::string& name, const glm::vec4& value);
     void setVec3(const std::string& name, const glm::vec3& value);
     void setVec2(const std::string& name, const glm::vec2 value);
+
+    // every uniform in res/shaders declares its location, and a name has the same one in every shader so any
+    // set of stages links. They are read from the sources, a SPIR-V program need not keep the names
+    GLint uniformLocation(const std::string& name) const;
+
+    // how many programs were built from the SPIR-V modules and how many from GLSL source
+    static unsigned int spirvProgramCount();
+    static unsigned int sourceProgramCount();
 private:
+    struct ShaderStage
+    {
+        const char* path;
+        GLenum      type;
+        const char* typeName;
+    };
+
+    // uniform name -> location, "name[i]" and "name.member" included; names the sources don't declare are
+    // asked of the driver once and kept as well (-1 if the program has no such uniform)
+    mutable std::unordered_map<std::string, GLint> uniformLocations;
+
+    // builds the program from the SPIR-V modules produced by the build, falling back to the GLSL sources
+    // ------------------------------------------------------------------------
+    void build(const std::vector<ShaderStage>& stages, const std::vector<SpecializationConstant>& constants);
+    bool buildFromSpirv(const std::vector<ShaderStage>& stages, const std::vector<SpecializationConstant>& constants, std::string& reason);
+    void buildFromSource(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources,
+                         const std::vector<SpecializationConstant>& constants);
+
+    // the explicit uniform locations a stage's source declares
+    void collectUniformLocations(const std::string& source);
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type);
-    
+    bool checkCompileErrors(unsigned int shader, std::string type);
+
 };
 #endif
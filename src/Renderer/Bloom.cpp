@@ -0,0 +1,80 @@
+#include "Bloom.h"
+#include "GLState.h"
+#include "TextureUnits.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr GLuint WorkGroupSize = 8;
+    constexpr GLenum ChainFormat = GL_R11F_G11F_B10F;
+
+    void dispatchLevel(GLsizei width, GLsizei height)
+    {
+        glDispatchCompute((width + WorkGroupSize - 1) / WorkGroupSize, (height + WorkGroupSize - 1) / WorkGroupSize, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+}
+
+GLsizei Bloom::chainLevels(GLsizei width, GLsizei height) const
+{
+    // no level smaller than a texel
+    GLsizei available = 0;
+    for (GLsizei size = std::min(width, height) / 2; size >= 1; size /= 2)
+        available++;
+    return std::clamp<GLsizei>(levels, 1, std::max<GLsizei>(1, std::min<GLsizei>(available, MaxLevels)));
+}
+
+RenderTargetPool::Desc Bloom::chainDesc(GLsizei width, GLsizei height) const
+{
+    return { std::max(1, width / 2), std::max(1, height / 2), ChainFormat, RenderTargetPool::Storage, chainLevels(width, height) };
+}
+
+GLuint Bloom::sampler()
+{
+    if (linearSampler == 0)
+    {
+        glCreateSamplers(1, &linearSampler);
+        glSamplerParameteri(linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+        glSamplerParameteri(linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glSamplerParameteri(linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glSamplerParameteri(linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    return linearSampler;
+}
+
+void Bloom::build(GLuint brightColor, GLuint chain, GLsizei width, GLsizei height, const glm::vec2& uvScale)
+{
+    if (!filterShader)
+        filterShader = std::make_unique<Shader>("res/shaders/bloom.comp");
+
+    const RenderTargetPool::Desc desc = chainDesc(width, height);
+    filterShader->use();
+    filterShader->setVec2("uvScale", uvScale);
+    GLState::bindSampler(TextureUnit::BloomSource, sampler());
+
+    // down: level 0 from the bright color, every other level from the one above it
+    filterShader->setBool("upsample", false);
+    for (GLsizei level = 0; level < desc.levels; level++)
+    {
+        GLState::bindTexture(TextureUnit::BloomSource, level == 0 ? brightColor : chain);
+        filterShader->setInt("sourceLevel", level == 0 ? 0 : level - 1);
+        filterShader->setBool("karisAverage", level == 0);
+        glBindImageTexture(0, chain, level, GL_FALSE, 0, GL_READ_WRITE, ChainFormat);
+        dispatchLevel(std::max(1, desc.width >> level), std::max(1, desc.height >> level));
+    }
+
+    // up: every level adds the tent filtered level below; level 0 is averaged over the levels so the
+    // strength does not depend on how many there are
+    filterShader->setBool("upsample", true);
+    filterShader->setFloat("filterRadius", filterRadius);
+    GLState::bindTexture(TextureUnit::BloomSource, chain);
+    for (GLsizei level = desc.levels - 2; level >= 0; level--)
+    {
+        filterShader->setInt("sourceLevel", level + 1);
+        filterShader->setFloat("scale", level == 0 ? 1.0f / desc.levels : 1.0f);
+        glBindImageTexture(0, chain, level, GL_FALSE, 0, GL_READ_WRITE, ChainFormat);
+        dispatchLevel(std::max(1, desc.width >> level), std::max(1, desc.height >> level));
+    }
+    GLState::bindSampler(TextureUnit::BloomSource, 0);
+}
@@ -0,0 +1,44 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "RenderTargetPool.h"
+#include "Object/Shader.h"
+
+#include <memory>
+
+// Bloom over a mip chain built in compute: the bright color is downsampled level by level with a 13-tap
+// filter, the first step weighting its taps by inverse luma so single bright texels do not flicker, then
+// upsampled back up with a 3x3 tent, every level adding the blurred level below to itself. Level 0, at half
+// the screen resolution, ends up holding the bloom. Each level costs a quarter of the one above, so the
+// kernel widens with every level for little more than the first one costs.
+class Bloom
+{
+public:
+    static constexpr int MaxLevels = 8;
+
+    // levels of the chain, the more the wider the glow
+    int levels = 6;
+    // of the upsampling tent, in texels of the level it reads
+    float filterRadius = 1.0f;
+
+    // the chain's target for a width x height bright color
+    RenderTargetPool::Desc chainDesc(GLsizei width, GLsizei height) const;
+
+    // fills chain (a target of chainDesc(width, height)) from brightColor. When the scene renders to a
+    // corner of larger targets, width x height is that corner, uvScale its size in texture coordinates and
+    // chain is of chainDesc for the full size; only the matching corner of every level is filled
+    void build(GLuint brightColor, GLuint chain, GLsizei width, GLsizei height, const glm::vec2& uvScale = glm::vec2(1.0f));
+
+    // bilinear filtering for the chain, which as a storage target would sample nearest
+    GLuint sampler();
+
+private:
+    GLsizei chainLevels(GLsizei width, GLsizei height) const;
+
+    std::unique_ptr<Shader> filterShader;
+    GLuint linearSampler = 0;
+};
+#endif
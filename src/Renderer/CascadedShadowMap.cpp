@@ -0,0 +1,93 @@
+#include "CascadedShadowMap.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+void CascadedShadowMap::init(GLsizei size)
+{
+    cascadeSize = size;
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &depthArray);
+    glTextureStorage3D(depthArray, 1, GL_DEPTH_COMPONENT24, size, size, CascadeCount);
+    glTextureParameteri(depthArray, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(depthArray, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(depthArray, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTextureParameteri(depthArray, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    const float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    glTextureParameterfv(depthArray, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+    // a whole array as the attachment makes the framebuffer layered, gl_Layer picks the cascade
+    glCreateFramebuffers(1, &fbo);
+    glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, depthArray, 0);
+    glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+    glNamedFramebufferReadBuffer(fbo, GL_NONE);
+}
+
+void CascadedShadowMap::update(const glm::mat4& view, float fovY, float aspect, float nearPlane, float shadowDistance, const glm::vec3& towardLight)
+{
+    const glm::vec3 lightDirection = glm::normalize(towardLight);
+    const glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -lightDirection, up);
+    const glm::mat4 inverseLightRotation = glm::inverse(lightRotation);
+    const glm::mat4 inverseView = glm::inverse(view);
+    const float tanHalfY = std::tan(fovY * 0.5f);
+    const float tanHalfX = tanHalfY * aspect;
+
+    float sliceNear = nearPlane;
+    for (int cascade = 0; cascade < CascadeCount; cascade++)
+    {
+        // practical split scheme: a blend of logarithmic and uniform distances
+        const float t = static_cast<float>(cascade + 1) / CascadeCount;
+        const float logSplit = nearPlane * std::pow(shadowDistance / nearPlane, t);
+        const float uniformSplit = nearPlane + (shadowDistance - nearPlane) * t;
+        const float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+
+        // corners of the slice in world space; the slice is rigid relative to the camera, so its bounding
+        // sphere keeps its radius however the camera turns
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < 8; i++)
+        {
+            const float depth = i < 4 ? sliceNear : sliceFar;
+            const glm::vec4 viewCorner((i & 1 ? 1.0f : -1.0f) * tanHalfX * depth, (i & 2 ? 1.0f : -1.0f) * tanHalfY * depth, -depth, 1.0f);
+            corners[i] = glm::vec3(inverseView * viewCorner);
+            center += corners[i] / 8.0f;
+        }
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        // snap the center to the texel grid of the light's view plane
+        const float texel = 2.0f * radius / static_cast<float>(cascadeSize);
+        glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+        lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+        lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+        // and its depth along the light to coarse steps, so the matrix (and the cached cascade) only changes
+        // once the camera moved a texel across or a step along the light. Snapping moves the center away from
+        // the light by up to a step, the box starts a step further toward the light to make up for it
+        const float depthStep = radius * 0.25f;
+        lightCenter.z = std::floor(lightCenter.z / depthStep) * depthStep;
+        center = glm::vec3(inverseLightRotation * glm::vec4(lightCenter, 1.0f));
+
+        // the box reaches casterDistance past the slice toward the light, for casters outside the view
+        const glm::mat4 lightView = glm::lookAt(center + lightDirection * (radius + casterDistance + depthStep), center, up);
+        const glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + casterDistance + depthStep);
+        matrices[cascade] = lightProjection * lightView;
+        splits[cascade] = sliceFar;
+        sliceNear = sliceFar;
+    }
+}
+
+void CascadedShadowMap::apply(Shader& shader) const
+{
+    for (int cascade = 0; cascade < CascadeCount; cascade++)
+    {
+        const std::string index = "[" + std::to_string(cascade) + "]";
+        shader.setMat4("cascadeMatrices" + index, matrices[cascade]);
+        shader.setFloat("cascadeSplits" + index, splits[cascade]);
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef CASCADED_SHADOW_MAP_H
+#define CASCADED_SHADOW_MAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+#include "Object/Shader.h"
+
+#include <array>
+
+// Directional light shadows over the camera frustum, split in depth into cascades. Each cascade is an
+// orthographic light box fitted to the bounding sphere of its slice of the camera frustum, so the size of
+// the box does not change as the camera turns, and its origin is snapped to whole shadow texels (and coarse
+// steps along the light), so it only moves in texel steps as the camera moves; both keep the shadow edges
+// from swimming, and let a cached cascade survive until its own matrix changes.
+//
+// The cascades are the layers of one depth texture array attached layered to one framebuffer; casters are
+// drawn once per cascade they overlap and shadowmap.vert routes them to the cascade's layer. Receivers pick
+// the cascade by their view space depth (cascadeSplits) and sample with its matrix (cascadeMatrices).
+class CascadedShadowMap
+{
+public:
+    // must match shadowmap.vert and object.frag
+    static constexpr int CascadeCount = 4;
+
+    // split distribution between uniform (0) and logarithmic (1)
+    float splitLambda = 0.75f;
+    // how far in front of a cascade's slice casters are still drawn into it
+    float casterDistance = 20.0f;
+
+    // size x size texels per cascade
+    void init(GLsizei size);
+
+    // refits the cascades to the camera frustum between nearPlane and shadowDistance; towardLight points
+    // from the scene at the light
+    void update(const glm::mat4& view, float fovY, float aspect, float nearPlane, float shadowDistance, const glm::vec3& towardLight);
+
+    // cascadeMatrices and cascadeSplits for the casters' vertex shader and the receivers
+    void apply(Shader& shader) const;
+
+    const glm::mat4& matrix(int cascade) const { return matrices[cascade]; }
+    Frustum frustum(int cascade) const { return Frustum::fromMatrix(matrices[cascade]); }
+    // far end of the cascade in view space depth
+    float splitDistance(int cascade) const { return splits[cascade]; }
+
+    GLuint texture() const { return depthArray; }
+    GLuint framebuffer() const { return fbo; }
+    GLsizei size() const { return cascadeSize; }
+
+private:
+    GLuint depthArray = 0, fbo = 0;
+    GLsizei cascadeSize = 0;
+    std::array<glm::mat4, CascadeCount> matrices = {};
+    std::array<float, CascadeCount> splits = {};
+};
+#endif
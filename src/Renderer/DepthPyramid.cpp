@@ -0,0 +1,40 @@
+#include "DepthPyramid.h"
+#include "GLState.h"
+#include "TextureUnits.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr GLuint WorkGroupSize = 8;
+}
+
+GLsizei DepthPyramid::levelsFor(GLsizei width, GLsizei height)
+{
+    GLsizei levels = 1;
+    for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
+
+void DepthPyramid::build(GLuint depth, GLuint pyramid, GLsizei width, GLsizei height)
+{
+    if (!reduceShader)
+        reduceShader = std::make_unique<Shader>("res/shaders/hiz.comp");
+
+    reduceShader->use();
+    const GLsizei levels = levelsFor(width, height);
+    for (GLsizei level = 0; level < levels; level++)
+    {
+        // level 0 copies the depth buffer, every other level reduces the one above it
+        GLState::bindTexture(TextureUnit::DepthPyramid, level == 0 ? depth : pyramid);
+        reduceShader->setInt("sourceLevel", level == 0 ? 0 : level - 1);
+        reduceShader->setBool("copy", level == 0);
+        glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        const GLuint levelWidth = std::max(1, width >> level);
+        const GLuint levelHeight = std::max(1, height >> level);
+        glDispatchCompute((levelWidth + WorkGroupSize - 1) / WorkGroupSize, (levelHeight + WorkGroupSize - 1) / WorkGroupSize, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+}
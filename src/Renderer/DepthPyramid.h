@@ -0,0 +1,25 @@
+#ifndef DEPTH_PYRAMID_H
+#define DEPTH_PYRAMID_H
+
+#include <glad/glad.h>
+
+#include "Object/Shader.h"
+
+#include <memory>
+
+// Hierarchical Z: a GL_R32F mip chain over a depth buffer where every texel holds the farthest depth of the
+// texels it covers one level down, so a screen rectangle can be tested for occlusion with four fetches at
+// the level where it spans at most 2x2 texels. Level 0 has the size of the depth buffer.
+class DepthPyramid
+{
+public:
+    // mip levels of a pyramid over a width x height depth buffer
+    static GLsizei levelsFor(GLsizei width, GLsizei height);
+
+    // fills every level of pyramid (levelsFor(width, height) levels of GL_R32F) from depth
+    void build(GLuint depth, GLuint pyramid, GLsizei width, GLsizei height);
+
+private:
+    std::unique_ptr<Shader> reduceShader;
+};
+#endif
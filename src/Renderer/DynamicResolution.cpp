@@ -0,0 +1,78 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // weight of a new measurement in the running average
+    constexpr float Smoothing = 0.2f;
+    // frames to hold a new scale before judging it: its first frames are still in flight, then a few more
+    // let the average catch up
+    constexpr int SettleFrames = DynamicResolution::QueryLatency + 8;
+}
+
+void DynamicResolution::beginFrame()
+{
+    if (queries[0][0] == 0)
+        glCreateQueries(GL_TIMESTAMP, QueryLatency * 2, &queries[0][0]);
+
+    // the slot about to be reused holds the frame from QueryLatency frames ago
+    const int slot = frame % QueryLatency;
+    if (!enabled)
+        currentScale = 1.0f;
+    if (pending[slot])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+            const float frameMs = static_cast<float>(end - begin) * 1e-6f;
+            averageMs = averageMs > 0.0f ? averageMs + (frameMs - averageMs) * Smoothing : frameMs;
+            if (enabled)
+                adjust();
+        }
+        // not ready after that long: drop it rather than stall
+        pending[slot] = false;
+    }
+
+    glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+}
+
+void DynamicResolution::endFrame()
+{
+    const int slot = frame % QueryLatency;
+    glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+    pending[slot] = true;
+    frame++;
+}
+
+GLsizei DynamicResolution::scaled(GLsizei size) const
+{
+    return std::max<GLsizei>(1, static_cast<GLsizei>(std::lround(size * currentScale)));
+}
+
+void DynamicResolution::adjust()
+{
+    float next = currentScale;
+    if (settleFrames > 0)
+        settleFrames--;
+    else if (averageMs > targetMs)
+    {
+        // GPU time goes with the pixel count, the square of the scale; at least one step down
+        const float fit = currentScale * std::sqrt(targetMs / averageMs);
+        next = std::min(std::floor(fit / Step) * Step, currentScale - Step);
+    }
+    else if (averageMs < targetMs * headroom)
+        next = currentScale + Step;
+
+    next = std::clamp(std::round(next / Step) * Step, minScale, std::max(minScale, maxScale));
+    if (next != currentScale)
+    {
+        currentScale = next;
+        settleFrames = SettleFrames;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+// Scales the resolution of the HDR passes to keep the GPU time of a frame within a budget. Every frame is
+// bracketed by two timestamp queries; results are read QueryLatency frames later, when they are ready, so
+// the CPU never waits on them. The scale drops as soon as the averaged time goes over the budget and only
+// climbs back, one step at a time, once it is well under it (headroom); after a change it holds still until
+// frames rendered at the new scale have been measured. The scale is quantized to Step so the render size
+// does not creep a pixel at a time.
+class DynamicResolution
+{
+public:
+    static constexpr int QueryLatency = 4;
+    static constexpr float Step = 0.05f;
+
+    bool enabled = false;
+    float targetMs = 16.0f;  // GPU budget of a frame
+    float minScale = 0.5f;   // per axis
+    float maxScale = 1.0f;
+    float headroom = 0.85f;  // scales up only under targetMs * headroom
+
+    // around everything the scale applies to; beginFrame also takes in the results that are ready
+    void beginFrame();
+    void endFrame();
+
+    float scale() const { return currentScale; }
+    // the last measured GPU time, averaged over a few frames
+    float gpuMs() const { return averageMs; }
+
+    // render size for an output size, at least a pixel
+    GLsizei scaled(GLsizei size) const;
+
+private:
+    void adjust();
+
+    GLuint queries[QueryLatency][2] = {};
+    bool pending[QueryLatency] = {};
+    int frame = 0;
+    float currentScale = 1.0f;
+    float averageMs = 0.0f;
+    int settleFrames = 0;
+};
+#endif
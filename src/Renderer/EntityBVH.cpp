@@ -0,0 +1,224 @@
+#include "EntityBVH.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENTITY_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // bit i set if slot i is outside some plane, or not entirely inside all of them
+    struct PlaneMasks
+    {
+        int outside;
+        int partial;
+    };
+
+    template<typename NodeT>
+    PlaneMasks testNode(const NodeT& node, const Frustum& frustum)
+    {
+        PlaneMasks masks = { 0, 0 };
+#ifdef ENTITY_BVH_SSE
+        const __m128 minX = _mm_load_ps(node.minX), minY = _mm_load_ps(node.minY), minZ = _mm_load_ps(node.minZ);
+        const __m128 maxX = _mm_load_ps(node.maxX), maxY = _mm_load_ps(node.maxY), maxZ = _mm_load_ps(node.maxZ);
+        const __m128 zero = _mm_setzero_ps();
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            const __m128 nx = _mm_set1_ps(plane.x), ny = _mm_set1_ps(plane.y), nz = _mm_set1_ps(plane.z);
+            const __m128 x0 = _mm_mul_ps(nx, minX), x1 = _mm_mul_ps(nx, maxX);
+            const __m128 y0 = _mm_mul_ps(ny, minY), y1 = _mm_mul_ps(ny, maxY);
+            const __m128 z0 = _mm_mul_ps(nz, minZ), z1 = _mm_mul_ps(nz, maxZ);
+            const __m128 d = _mm_set1_ps(plane.w);
+
+            // distance of the corner furthest along the normal, and of the one furthest against it
+            const __m128 farthest = _mm_add_ps(_mm_add_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_add_ps(_mm_max_ps(z0, z1), d));
+            const __m128 nearest = _mm_add_ps(_mm_add_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_add_ps(_mm_min_ps(z0, z1), d));
+            masks.outside |= _mm_movemask_ps(_mm_cmplt_ps(farthest, zero));
+            masks.partial |= _mm_movemask_ps(_mm_cmplt_ps(nearest, zero));
+        }
+#else
+        for (const glm::vec4& plane : frustum.planes)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                const float x0 = plane.x * node.minX[i], x1 = plane.x * node.maxX[i];
+                const float y0 = plane.y * node.minY[i], y1 = plane.y * node.maxY[i];
+                const float z0 = plane.z * node.minZ[i], z1 = plane.z * node.maxZ[i];
+                if (std::max(x0, x1) + std::max(y0, y1) + std::max(z0, z1) + plane.w < 0.0f)
+                    masks.outside |= 1 << i;
+                if (std::min(x0, x1) + std::min(y0, y1) + std::min(z0, z1) + plane.w < 0.0f)
+                    masks.partial |= 1 << i;
+            }
+        }
+#endif
+        return masks;
+    }
+}
+
+void EntityBVH::build(const std::vector<Entity*>& entities)
+{
+    nodes.clear();
+    items.clear();
+    // entities without meshes have nothing to cull
+    for (Entity* entity : entities)
+    {
+        const AABB bounds = entity->worldBounds();
+        if (!bounds.empty())
+            items.push_back({ entity, entity->transform.getModelMatrix(), bounds });
+    }
+    if (items.empty())
+        return;
+
+    std::vector<uint32_t> order(items.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    buildNode(order, 0, order.size());
+}
+
+int32_t EntityBVH::buildNode(std::vector<uint32_t>& order, size_t begin, size_t end)
+{
+    // nodes are laid out in pre-order: children always follow their parent, which refit() relies on
+    const int32_t index = static_cast<int32_t>(nodes.size());
+    nodes.push_back({});
+
+    const size_t count = end - begin;
+    int32_t children[Width];
+    int slots = 0;
+    if (count <= Width)
+    {
+        for (size_t i = begin; i < end; i++)
+            children[slots++] = ~static_cast<int32_t>(order[i]);
+    }
+    else
+    {
+        // split along the longest axis of the centroids into up to four equal runs
+        AABB centroids;
+        for (size_t i = begin; i < end; i++)
+            centroids.expand(items[order[i]].bounds.center());
+        const glm::vec3 extent = centroids.max - centroids.min;
+        const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        std::sort(order.begin() + begin, order.begin() + end, [&](uint32_t a, uint32_t b) {
+            return items[a].bounds.center()[axis] < items[b].bounds.center()[axis];
+        });
+
+        const size_t run = (count + Width - 1) / Width;
+        for (size_t runBegin = begin; runBegin < end; runBegin += run)
+        {
+            const size_t runEnd = std::min(runBegin + run, end);
+            children[slots++] = runEnd - runBegin == 1 ? ~static_cast<int32_t>(order[runBegin]) : buildNode(order, runBegin, runEnd);
+        }
+    }
+
+    // the recursion may have reallocated nodes, only index from here on
+    nodes[index].count = slots;
+    for (int slot = 0; slot < Width; slot++)
+    {
+        nodes[index].children[slot] = slot < slots ? children[slot] : 0;
+        if (slot >= slots)
+            setSlot(nodes[index], slot, AABB());
+        else if (children[slot] < 0)
+            setSlot(nodes[index], slot, items[~children[slot]].bounds);
+        else
+            setSlot(nodes[index], slot, nodeBounds(nodes[children[slot]]));
+    }
+    return index;
+}
+
+bool EntityBVH::refit()
+{
+    bool moved = false;
+    for (Item& item : items)
+    {
+        if (item.entity->transform.isDirty())
+            item.entity->forceUpdateSelfAndChild();
+        const glm::mat4& model = item.entity->transform.getModelMatrix();
+        if (model != item.model)
+        {
+            item.model = model;
+            item.bounds = item.entity->worldBounds();
+            moved = true;
+        }
+    }
+    if (!moved)
+        return false;
+
+    // children come after their parents, so walking backwards refits bottom up
+    for (size_t i = nodes.size(); i-- > 0;)
+    {
+        Node& node = nodes[i];
+        for (int slot = 0; slot < node.count; slot++)
+        {
+            const int32_t child = node.children[slot];
+            setSlot(node, slot, child < 0 ? items[~child].bounds : nodeBounds(nodes[child]));
+        }
+    }
+    return true;
+}
+
+void EntityBVH::cull(const Frustum& frustum, std::vector<Entity*>& visible)
+{
+    visible.clear();
+    frameStats = { static_cast<uint32_t>(nodes.size()), static_cast<uint32_t>(items.size()), 0, 0 };
+    if (nodes.empty())
+        return;
+
+    int32_t stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+        frameStats.nodesTested++;
+
+        const PlaneMasks masks = testNode(node, frustum);
+        const int inside = ((1 << node.count) - 1) & ~masks.outside;
+        for (int slot = 0; slot < node.count; slot++)
+        {
+            if (!(inside & (1 << slot)))
+                continue;
+            const int32_t child = node.children[slot];
+            if (!(masks.partial & (1 << slot)))
+                addSubtree(child, visible);
+            else if (child < 0)
+                visible.push_back(items[~child].entity);
+            else
+                stack[top++] = child;
+        }
+    }
+    frameStats.visible = static_cast<uint32_t>(visible.size());
+}
+
+void EntityBVH::addSubtree(int32_t child, std::vector<Entity*>& visible) const
+{
+    if (child < 0)
+    {
+        visible.push_back(items[~child].entity);
+        return;
+    }
+    const Node& node = nodes[child];
+    for (int slot = 0; slot < node.count; slot++)
+        addSubtree(node.children[slot], visible);
+}
+
+AABB EntityBVH::nodeBounds(const Node& node) const
+{
+    AABB bounds;
+    for (int slot = 0; slot < node.count; slot++)
+    {
+        bounds.expand(glm::vec3(node.minX[slot], node.minY[slot], node.minZ[slot]));
+        bounds.expand(glm::vec3(node.maxX[slot], node.maxY[slot], node.maxZ[slot]));
+    }
+    return bounds;
+}
+
+void EntityBVH::setSlot(Node& node, int slot, const AABB& bounds)
+{
+    node.minX[slot] = bounds.min.x;
+    node.minY[slot] = bounds.min.y;
+    node.minZ[slot] = bounds.min.z;
+    node.maxX[slot] = bounds.max.x;
+    node.maxY[slot] = bounds.max.y;
+    node.maxZ[slot] = bounds.max.z;
+}
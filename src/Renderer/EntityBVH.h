@@ -0,0 +1,70 @@
+#ifndef ENTITY_BVH_H
+#define ENTITY_BVH_H
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+#include "Object/AABB.h"
+#include "Object/Entity.h"
+
+#include <cstdint>
+#include <vector>
+
+// Four-wide bounding volume hierarchy over the world bounds of a set of entities, for frustum culling on
+// the CPU. Every node holds the boxes of up to four children (entities or nodes) as structure of arrays, so
+// one node is tested against a plane with a handful of SSE instructions; nodes entirely inside the frustum
+// hand over their whole subtree without further tests.
+//
+// The tree is built once; refit() follows transforms that changed since by growing or shrinking the boxes
+// in place, the topology stays. Rebuild if entities move far enough for the tree to degrade.
+class EntityBVH
+{
+public:
+    struct Stats
+    {
+        uint32_t nodes;
+        uint32_t entities;
+        uint32_t nodesTested;
+        uint32_t visible;
+    };
+
+    void build(const std::vector<Entity*>& entities);
+
+    // re-reads the bounds of entities whose model matrix changed and refits the nodes above them;
+    // returns whether anything moved
+    bool refit();
+
+    // replaces visible with the entities whose bounds intersect the frustum
+    void cull(const Frustum& frustum, std::vector<Entity*>& visible);
+
+    const Stats& stats() const { return frameStats; }
+
+private:
+    static constexpr int Width = 4;
+
+    // child slot: >= 0 a node index, < 0 the entity ~slot
+    struct alignas(16) Node
+    {
+        float minX[Width], minY[Width], minZ[Width];
+        float maxX[Width], maxY[Width], maxZ[Width];
+        int32_t children[Width];
+        int32_t count;
+    };
+
+    struct Item
+    {
+        Entity* entity;
+        glm::mat4 model; // the matrix bounds was computed with
+        AABB bounds;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Item> items;
+    Stats frameStats = {};
+
+    int32_t buildNode(std::vector<uint32_t>& order, size_t begin, size_t end);
+    AABB nodeBounds(const Node& node) const;
+    void setSlot(Node& node, int slot, const AABB& bounds);
+    void addSubtree(int32_t child, std::vector<Entity*>& visible) const;
+};
+#endif
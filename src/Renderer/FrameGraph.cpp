@@ -0,0 +1,211 @@
+#include "FrameGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+    GLbitfield barrierBit(FrameGraph::Access access)
+    {
+        switch (access)
+        {
+        case FrameGraph::Attachment:    return GL_FRAMEBUFFER_BARRIER_BIT;
+        case FrameGraph::Sampled:       return GL_TEXTURE_FETCH_BARRIER_BIT;
+        case FrameGraph::Image:         return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+        case FrameGraph::StorageBuffer: return GL_SHADER_STORAGE_BARRIER_BIT;
+        case FrameGraph::VertexBuffer:  return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT;
+        case FrameGraph::Indirect:      return GL_COMMAND_BARRIER_BIT;
+        }
+        return GL_ALL_BARRIER_BITS;
+    }
+
+    constexpr GLbitfield AllAccessBits = GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                                         GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                                         GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT;
+
+    // only shader stores bypass the usual GL ordering and need glMemoryBarrier before anything else sees them
+    bool incoherent(FrameGraph::Access access)
+    {
+        return access == FrameGraph::Image || access == FrameGraph::StorageBuffer;
+    }
+}
+
+FrameGraph::Resource FrameGraph::PassBuilder::create(const std::string& name, const RenderTargetPool::Desc& desc)
+{
+    graph.resources.push_back({ name, false, false, desc, 0, 0, 0 });
+    return static_cast<Resource>(graph.resources.size() - 1);
+}
+
+void FrameGraph::PassBuilder::read(Resource resource, Access access)
+{
+    graph.passes[pass].uses.push_back({ resource, access, false });
+}
+
+void FrameGraph::PassBuilder::write(Resource resource, Access access)
+{
+    graph.passes[pass].uses.push_back({ resource, access, true });
+}
+
+void FrameGraph::PassBuilder::sideEffect()
+{
+    graph.passes[pass].sideEffect = true;
+}
+
+void FrameGraph::reset()
+{
+    resources.clear();
+    passes.clear();
+}
+
+FrameGraph::Resource FrameGraph::importTexture(const std::string& name, GLuint texture)
+{
+    resources.push_back({ name, true, false, {}, texture, 0, 0 });
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+FrameGraph::Resource FrameGraph::importBuffer(const std::string& name, GLuint buffer)
+{
+    resources.push_back({ name, true, true, {}, buffer, 0, 0 });
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+void FrameGraph::addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, std::function<void()> execute)
+{
+    passes.push_back({ name, std::move(execute), {}, false, false });
+    PassBuilder builder(*this, passes.size() - 1);
+    setup(builder);
+}
+
+void FrameGraph::cull()
+{
+    for (PassNode& pass : passes)
+        pass.live = pass.sideEffect;
+
+    // walking backwards, a live pass keeps every earlier pass writing something it reads
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        if (!passes[i].live)
+            continue;
+        for (const Use& use : passes[i].uses)
+        {
+            if (use.write)
+                continue;
+            for (size_t j = 0; j < i; j++)
+            {
+                const bool writes = std::any_of(passes[j].uses.begin(), passes[j].uses.end(),
+                                                [&](const Use& other) { return other.write && other.resource == use.resource; });
+                if (writes)
+                    passes[j].live = true;
+            }
+        }
+    }
+}
+
+GLbitfield FrameGraph::barrierFor(const PassNode& pass)
+{
+    GLbitfield bits = 0;
+    for (const Use& use : pass.uses)
+    {
+        const ResourceNode& resource = resources[use.resource];
+        for (const PendingWrite& pending : pendingWrites)
+            if (pending.buffer == resource.buffer && pending.object == resource.object)
+                bits |= barrierBit(use.access) & ~pending.visibleTo;
+    }
+    return bits;
+}
+
+void FrameGraph::recordWrites(const PassNode& pass)
+{
+    for (const Use& use : pass.uses)
+    {
+        if (!use.write || !incoherent(use.access))
+            continue;
+        const ResourceNode& resource = resources[use.resource];
+        auto it = std::find_if(pendingWrites.begin(), pendingWrites.end(), [&](const PendingWrite& pending) {
+            return pending.buffer == resource.buffer && pending.object == resource.object;
+        });
+        if (it == pendingWrites.end())
+            pendingWrites.push_back({ resource.buffer, resource.object, 0 });
+        else
+            it->visibleTo = 0;
+    }
+}
+
+void FrameGraph::execute()
+{
+    cull();
+
+    frameStats = {};
+    frameStats.passes = static_cast<uint32_t>(passes.size());
+    log.clear();
+
+    // lifetimes of the transients over the surviving passes
+    for (ResourceNode& resource : resources)
+    {
+        resource.firstUse = passes.size();
+        resource.lastUse = 0;
+    }
+    for (size_t i = 0; i < passes.size(); i++)
+    {
+        if (!passes[i].live)
+            continue;
+        for (const Use& use : passes[i].uses)
+        {
+            ResourceNode& resource = resources[use.resource];
+            resource.firstUse = std::min(resource.firstUse, i);
+            resource.lastUse = std::max(resource.lastUse, i);
+        }
+    }
+
+    for (size_t i = 0; i < passes.size(); i++)
+    {
+        PassNode& pass = passes[i];
+        log.push_back(pass.live ? pass.name : "-" + pass.name);
+        if (!pass.live)
+        {
+            frameStats.culled++;
+            continue;
+        }
+
+        for (ResourceNode& resource : resources)
+        {
+            if (!resource.imported && resource.firstUse == i)
+            {
+                resource.object = RenderTargetPool::acquire(resource.desc);
+                frameStats.transients++;
+            }
+        }
+
+        if (const GLbitfield bits = barrierFor(pass))
+        {
+            glMemoryBarrier(bits);
+            frameStats.barriers++;
+            for (PendingWrite& pending : pendingWrites)
+                pending.visibleTo |= bits;
+        }
+
+        pass.run();
+        recordWrites(pass);
+
+        for (ResourceNode& resource : resources)
+            if (!resource.imported && resource.object && resource.lastUse == i)
+                RenderTargetPool::release(resource.object);
+    }
+
+    // writes every kind of access has seen are settled
+    pendingWrites.erase(std::remove_if(pendingWrites.begin(), pendingWrites.end(),
+                                       [](const PendingWrite& pending) { return (pending.visibleTo & AllAccessBits) == AllAccessBits; }),
+                        pendingWrites.end());
+}
+
+GLuint FrameGraph::texture(Resource resource) const
+{
+    return resources[resource].object;
+}
+
+GLuint FrameGraph::framebuffer(std::initializer_list<Resource> colors, Resource depth) const
+{
+    std::vector<GLuint> colorTargets;
+    for (Resource color : colors)
+        colorTargets.push_back(texture(color));
+    return RenderTargetPool::framebuffer(colorTargets, depth == None ? 0 : texture(depth));
+}
@@ -0,0 +1,129 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <glad/glad.h>
+
+#include "RenderTargetPool.h"
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// The frame as a list of passes that declare which resources they read and write, rebuilt every frame.
+//
+// execute() runs the passes in the order they were added, but first
+//  - culls passes none of whose writes reach a pass with side effects (drawing to the default framebuffer),
+//  - gives every transient target the lifetime from its first to its last surviving use, acquiring it from
+//    the RenderTargetPool right before and releasing it right after, so targets with disjoint lifetimes alias,
+//  - issues one glMemoryBarrier before a pass if it consumes an incoherent write (image or storage buffer
+//    stores) that no earlier barrier made visible to that kind of access.
+class FrameGraph
+{
+public:
+    typedef uint32_t Resource;
+    static constexpr Resource None = ~0u;
+
+    // how a pass touches a resource, decides the barrier bits
+    enum Access
+    {
+        Attachment,    // framebuffer attachment
+        Sampled,       // texture fetch
+        Image,         // image load/store
+        StorageBuffer, // shader storage buffer
+        VertexBuffer,  // vertex attributes or indices
+        Indirect       // indirect draw/dispatch arguments
+    };
+
+    class PassBuilder
+    {
+    public:
+        // a transient target, valid only while the passes using it execute; declare the use with write()
+        Resource create(const std::string& name, const RenderTargetPool::Desc& desc);
+        void read(Resource resource, Access access);
+        void write(Resource resource, Access access);
+        // keep the pass even if nothing reads what it writes
+        void sideEffect();
+
+    private:
+        friend class FrameGraph;
+        PassBuilder(FrameGraph& graph, size_t pass) : graph(graph), pass(pass) {}
+        FrameGraph& graph;
+        size_t pass;
+    };
+
+    struct Stats
+    {
+        uint32_t passes;
+        uint32_t culled;
+        uint32_t barriers;
+        uint32_t transients;
+    };
+
+    // drops last frame's passes and resources; barrier state of imported resources is kept
+    void reset();
+
+    Resource importTexture(const std::string& name, GLuint texture);
+    Resource importBuffer(const std::string& name, GLuint buffer);
+
+    // setup runs immediately and declares the pass's resources, execute runs from execute()
+    void addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, std::function<void()> execute);
+
+    void execute();
+
+    // only valid while the passes using the resource execute
+    GLuint texture(Resource resource) const;
+    // framebuffer over transient or imported textures, see RenderTargetPool::framebuffer
+    GLuint framebuffer(std::initializer_list<Resource> colors, Resource depth = None) const;
+
+    const Stats& stats() const { return frameStats; }
+    // name of every pass of the last execute(), culled ones prefixed with '-'
+    const std::vector<std::string>& passLog() const { return log; }
+
+private:
+    struct ResourceNode
+    {
+        std::string name;
+        bool imported;
+        bool buffer;
+        RenderTargetPool::Desc desc;
+        GLuint object;
+        size_t firstUse, lastUse;
+    };
+
+    struct Use
+    {
+        Resource resource;
+        Access access;
+        bool write;
+    };
+
+    struct PassNode
+    {
+        std::string name;
+        std::function<void()> run;
+        std::vector<Use> uses;
+        bool sideEffect;
+        bool live;
+    };
+
+    // incoherent writes not yet made visible to every kind of access, by (buffer?, GL name)
+    struct PendingWrite
+    {
+        bool buffer;
+        GLuint object;
+        GLbitfield visibleTo;
+    };
+
+    std::vector<ResourceNode> resources;
+    std::vector<PassNode> passes;
+    std::vector<PendingWrite> pendingWrites;
+    std::vector<std::string> log;
+    Stats frameStats = {};
+
+    void cull();
+    GLbitfield barrierFor(const PassNode& pass);
+    void recordWrites(const PassNode& pass);
+};
+#endif
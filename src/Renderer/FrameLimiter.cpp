@@ -0,0 +1,79 @@
+#include "FrameLimiter.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+const char* FrameLimiter::modeName(Mode mode)
+{
+    switch (mode)
+    {
+    case Uncapped:  return "uncapped";
+    case FixedRate: return "fixed rate";
+    default:        return "vsync";
+    }
+}
+
+bool FrameLimiter::parse(const char* argument)
+{
+    if (std::strcmp(argument, "vsync") == 0)
+        current = VSync;
+    else if (std::strcmp(argument, "uncapped") == 0)
+        current = Uncapped;
+    else
+    {
+        char* end = nullptr;
+        const double rate = std::strtod(argument, &end);
+        if (end == argument || *end != '\0' || rate <= 0.0)
+            return false;
+        current = FixedRate;
+        fps = rate;
+    }
+    return true;
+}
+
+void FrameLimiter::setMode(Mode mode)
+{
+    current = mode;
+    started = false;
+    // a fixed rate below the display's paces itself; vsync on top would round it to a divisor of the refresh
+    glfwSwapInterval(mode == VSync ? 1 : 0);
+}
+
+void FrameLimiter::setTargetFps(double rate)
+{
+    fps = std::max(1.0, rate);
+    started = false;
+}
+
+void FrameLimiter::wait()
+{
+    if (current != FixedRate)
+        return;
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    Clock::time_point now = Clock::now();
+    if (!started || now - deadline > 2 * period)
+    {
+        // first frame, or more than a period behind this frame's deadline: too far to catch up
+        deadline = now;
+        started = true;
+        return;
+    }
+    deadline += period;
+
+    while (std::chrono::duration<double>(deadline - now).count() > sleepOvershoot)
+    {
+        const Clock::time_point before = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        now = Clock::now();
+        // follow the scheduler's granularity: jump to a longer sleep at once, forget it slowly
+        const double slept = std::chrono::duration<double>(now - before).count();
+        sleepOvershoot = std::max(slept, sleepOvershoot * 0.99 + slept * 0.01);
+    }
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
@@ -0,0 +1,45 @@
+#ifndef FRAME_LIMITER_H
+#define FRAME_LIMITER_H
+
+#include <chrono>
+
+// How frames are paced: locked to the display (vsync), as fast as possible for profiling (uncapped), or at a
+// fixed rate below the display's to save power. The fixed rate keeps an absolute deadline per frame and
+// advances it by one period each time, so the lateness of one frame is made up by the next instead of
+// drifting; after a hitch of more than a period it starts over from now. Waiting sleeps while the deadline
+// is further off than a sleep has been seen to overshoot, and spins the rest.
+class FrameLimiter
+{
+public:
+    enum Mode
+    {
+        VSync,
+        Uncapped,
+        FixedRate
+    };
+
+    static const char* modeName(Mode mode);
+    // "vsync", "uncapped" or a number of frames per second, as given on the command line; false if it is none
+    bool parse(const char* argument);
+
+    // sets the swap interval for the mode, needs the context current
+    void setMode(Mode mode);
+    Mode mode() const { return current; }
+
+    void setTargetFps(double fps);
+    double targetFps() const { return fps; }
+
+    // call right before swapping buffers; in FixedRate returns at the frame's deadline
+    void wait();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Mode current = VSync;
+    double fps = 60.0;
+    Clock::time_point deadline;
+    bool started = false;
+    // longest a short sleep took lately, in seconds
+    double sleepOvershoot = 0.002;
+};
+#endif
@@ -0,0 +1,43 @@
+#include "FrameSync.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+void FrameSync::beginFrame()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t limit = static_cast<uint64_t>(std::clamp(framesInFlight, 1, MaxFramesInFlight));
+
+    // every frame at least framesInFlight behind this one, which includes the last user of this slot
+    for (int i = 0; i < MaxFramesInFlight; i++)
+    {
+        if (fences[i] == nullptr || fencedFrames[i] + limit > frameNumber)
+            continue;
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;)
+        {
+            const GLenum status = glClientWaitSync(fences[i], flags, 100000000); // 100 ms
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+                break;
+            if (status == GL_WAIT_FAILED)
+            {
+                std::cout << "[FrameSync] waiting for frame " << fencedFrames[i] << " failed" << std::endl;
+                break;
+            }
+            flags = 0; // flushed already
+        }
+        glDeleteSync(fences[i]);
+        fences[i] = nullptr;
+    }
+
+    waited = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrameSync::endFrame()
+{
+    const int current = slot();
+    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fencedFrames[current] = frameNumber;
+    frameNumber++;
+}
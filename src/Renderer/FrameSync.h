@@ -0,0 +1,39 @@
+#ifndef FRAME_SYNC_H
+#define FRAME_SYNC_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// Bounds how far the CPU runs ahead of the GPU. Every frame ends with a fence; before frame N starts, the CPU
+// waits for the fence of frame N - framesInFlight, so at most that many frames are queued and the latency
+// from input to display stays bounded. The wait is timed, which shows how far ahead the CPU would have run.
+//
+// slot() is the frame's index into resources kept once per possible frame in flight (MaxFramesInFlight of
+// them): when a frame starts, the last frame that used its slot has finished on the GPU, so the slot can be
+// overwritten without synchronizing with anything.
+class FrameSync
+{
+public:
+    static constexpr int MaxFramesInFlight = 3;
+
+    // 1 waits for the previous frame before starting the next, MaxFramesInFlight lets the driver queue most
+    int framesInFlight = 2;
+
+    // before anything of the frame is recorded; waits for the frames past the limit
+    void beginFrame();
+    // after the swap
+    void endFrame();
+
+    uint64_t frame() const { return frameNumber; }
+    int slot() const { return static_cast<int>(frameNumber % MaxFramesInFlight); }
+    // how long beginFrame blocked, in milliseconds
+    float waitMs() const { return waited; }
+
+private:
+    GLsync fences[MaxFramesInFlight] = {};
+    uint64_t fencedFrames[MaxFramesInFlight] = {};
+    uint64_t frameNumber = 0;
+    float waited = 0.0f;
+};
+#endif
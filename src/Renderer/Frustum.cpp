@@ -0,0 +1,34 @@
+#include "Frustum.h"
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+    // Gribb/Hartmann: every plane is the fourth row of the matrix plus or minus one of the others
+    const glm::mat4 m = glm::transpose(viewProjection);
+    Frustum frustum;
+    frustum.planes = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+    for (glm::vec4& plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (const glm::vec4& plane : planes)
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    return true;
+}
+
+bool Frustum::intersectsBox(const AABB& box) const
+{
+    // only the corner furthest along each plane's normal needs to be in front of it
+    for (const glm::vec4& plane : planes)
+    {
+        const glm::vec3 farthest(plane.x >= 0.0f ? box.max.x : box.min.x,
+                                 plane.y >= 0.0f ? box.max.y : box.min.y,
+                                 plane.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
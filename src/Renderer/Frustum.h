@@ -0,0 +1,23 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include "Object/AABB.h"
+
+#include <array>
+
+// The six planes of a view volume as (normal, distance) with normals pointing inside and normalized, so
+// dot(plane.xyz, p) + plane.w is the signed distance of p and a sphere is outside once it is below -radius.
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes; // left, right, bottom, top, near, far
+
+    // planes of the clip volume of a (projection * view) matrix
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+    // conservative: boxes outside the frustum but across a corner of it pass
+    bool intersectsBox(const AABB& box) const;
+};
+#endif
@@ -0,0 +1,257 @@
+#include "GLState.h"
+
+#include <array>
+
+namespace
+{
+    constexpr GLuint Unknown = ~0u;
+    constexpr GLuint TrackedTextureUnits = 96;
+
+    // capabilities the engine toggles; anything else is passed straight through
+    constexpr std::array<GLenum, 4> TrackedCapabilities = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST };
+
+    struct CachedState
+    {
+        GLuint program;
+        GLuint vertexArray;
+        GLuint drawFramebuffer;
+        GLuint readFramebuffer;
+        std::array<GLuint, TrackedTextureUnits> textures;
+        std::array<GLuint, TrackedTextureUnits> samplers;
+        std::array<int, TrackedCapabilities.size()> capabilities; // -1 unknown, 0 disabled, 1 enabled
+        GLenum blendSource, blendDestination;
+        GLenum depthFunc;
+        int depthMask;
+        GLint viewport[4];
+    };
+
+    CachedState cache;
+    GLState::Stats counters;
+
+    // returns true if the call has to be issued, and counts it either way
+    bool update(GLuint& cached, GLuint value, GLState::Counter counter)
+    {
+        if (cached == value)
+        {
+            counters.elided[counter]++;
+            return false;
+        }
+        cached = value;
+        counters.issued[counter]++;
+        return true;
+    }
+
+    int capabilityIndex(GLenum capability)
+    {
+        for (size_t i = 0; i < TrackedCapabilities.size(); i++)
+            if (TrackedCapabilities[i] == capability)
+                return static_cast<int>(i);
+        return -1;
+    }
+
+    void setCapability(GLenum capability, bool enabled)
+    {
+        const int index = capabilityIndex(capability);
+        if (index >= 0)
+        {
+            if (cache.capabilities[index] == static_cast<int>(enabled))
+            {
+                counters.elided[GLState::Capability]++;
+                return;
+            }
+            cache.capabilities[index] = enabled;
+        }
+        counters.issued[GLState::Capability]++;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+
+    struct Invalidator
+    {
+        Invalidator() { GLState::invalidate(); }
+    } invalidateOnStartup;
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if (update(cache.program, program, Program))
+        glUseProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vertexArray)
+{
+    if (update(cache.vertexArray, vertexArray, VertexArray))
+        glBindVertexArray(vertexArray);
+}
+
+void GLState::bindTexture(GLuint unit, GLuint texture)
+{
+    if (unit >= TrackedTextureUnits)
+    {
+        counters.issued[Texture]++;
+        glBindTextureUnit(unit, texture);
+        return;
+    }
+    if (update(cache.textures[unit], texture, Texture))
+        glBindTextureUnit(unit, texture);
+}
+
+void GLState::bindSampler(GLuint unit, GLuint sampler)
+{
+    if (unit >= TrackedTextureUnits)
+    {
+        counters.issued[Sampler]++;
+        glBindSampler(unit, sampler);
+        return;
+    }
+    if (update(cache.samplers[unit], sampler, Sampler))
+        glBindSampler(unit, sampler);
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    const bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    const bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if ((!draw || cache.drawFramebuffer == framebuffer) && (!read || cache.readFramebuffer == framebuffer))
+    {
+        counters.elided[Framebuffer]++;
+        return;
+    }
+    if (draw)
+        cache.drawFramebuffer = framebuffer;
+    if (read)
+        cache.readFramebuffer = framebuffer;
+    counters.issued[Framebuffer]++;
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GLState::enable(GLenum capability)
+{
+    setCapability(capability, true);
+}
+
+void GLState::disable(GLenum capability)
+{
+    setCapability(capability, false);
+}
+
+void GLState::blendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+    if (cache.blendSource == sourceFactor && cache.blendDestination == destinationFactor)
+    {
+        counters.elided[BlendFunc]++;
+        return;
+    }
+    cache.blendSource = sourceFactor;
+    cache.blendDestination = destinationFactor;
+    counters.issued[BlendFunc]++;
+    glBlendFunc(sourceFactor, destinationFactor);
+}
+
+void GLState::depthFunc(GLenum func)
+{
+    if (update(cache.depthFunc, func, DepthFunc))
+        glDepthFunc(func);
+}
+
+void GLState::depthMask(bool write)
+{
+    if (cache.depthMask == static_cast<int>(write))
+    {
+        counters.elided[DepthMask]++;
+        return;
+    }
+    cache.depthMask = write;
+    counters.issued[DepthMask]++;
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (cache.viewport[0] == x && cache.viewport[1] == y && cache.viewport[2] == width && cache.viewport[3] == height)
+    {
+        counters.elided[Viewport]++;
+        return;
+    }
+    cache.viewport[0] = x;
+    cache.viewport[1] = y;
+    cache.viewport[2] = width;
+    cache.viewport[3] = height;
+    counters.issued[Viewport]++;
+    glViewport(x, y, width, height);
+}
+
+void GLState::deleteTextures(GLsizei count, const GLuint* textures)
+{
+    glDeleteTextures(count, textures);
+    for (GLsizei i = 0; i < count; i++)
+        for (GLuint& bound : cache.textures)
+            if (bound == textures[i])
+                bound = 0;
+}
+
+void GLState::deleteSamplers(GLsizei count, const GLuint* samplers)
+{
+    glDeleteSamplers(count, samplers);
+    for (GLsizei i = 0; i < count; i++)
+        for (GLuint& bound : cache.samplers)
+            if (bound == samplers[i])
+                bound = 0;
+}
+
+void GLState::deleteFramebuffers(GLsizei count, const GLuint* framebuffers)
+{
+    glDeleteFramebuffers(count, framebuffers);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (cache.drawFramebuffer == framebuffers[i])
+            cache.drawFramebuffer = 0;
+        if (cache.readFramebuffer == framebuffers[i])
+            cache.readFramebuffer = 0;
+    }
+}
+
+void GLState::deleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+{
+    glDeleteVertexArrays(count, vertexArrays);
+    for (GLsizei i = 0; i < count; i++)
+        if (cache.vertexArray == vertexArrays[i])
+            cache.vertexArray = 0;
+}
+
+void GLState::invalidate()
+{
+    cache.program = Unknown;
+    cache.vertexArray = Unknown;
+    cache.drawFramebuffer = Unknown;
+    cache.readFramebuffer = Unknown;
+    cache.textures.fill(Unknown);
+    cache.samplers.fill(Unknown);
+    cache.capabilities.fill(-1);
+    cache.blendSource = cache.blendDestination = Unknown;
+    cache.depthFunc = Unknown;
+    cache.depthMask = -1;
+    cache.viewport[0] = cache.viewport[1] = -1;
+    cache.viewport[2] = cache.viewport[3] = -1;
+}
+
+const GLState::Stats& GLState::stats()
+{
+    return counters;
+}
+
+void GLState::resetStats()
+{
+    counters = Stats{};
+}
+
+const char* GLState::counterName(Counter counter)
+{
+    static const char* names[CounterCount] = {
+        "program", "vertex array", "texture", "sampler", "framebuffer",
+        "enable/disable", "blend func", "depth func", "depth mask", "viewport"
+    };
+    return names[counter];
+}
@@ -0,0 +1,64 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+
+// Thin cache over the GL state the engine changes every frame (program, VAO, texture units, samplers,
+// framebuffers, blend/depth state, viewport). All engine code binds through here, so calls that would
+// leave the state unchanged never reach the driver. Textures are bound with glBindTextureUnit, so the
+// active texture unit is never touched; texture setup code uses the DSA entry points for the same reason.
+//
+// Anything that changes GL state behind the cache's back (the ImGui backend) must be followed by invalidate().
+class GLState
+{
+public:
+    enum Counter
+    {
+        Program,
+        VertexArray,
+        Texture,
+        Sampler,
+        Framebuffer,
+        Capability,
+        BlendFunc,
+        DepthFunc,
+        DepthMask,
+        Viewport,
+        CounterCount
+    };
+
+    struct Stats
+    {
+        uint32_t issued[CounterCount] = {};
+        uint32_t elided[CounterCount] = {};
+    };
+
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vertexArray);
+    static void bindTexture(GLuint unit, GLuint texture);
+    static void bindSampler(GLuint unit, GLuint sampler);
+    static void bindFramebuffer(GLenum target, GLuint framebuffer);
+
+    static void enable(GLenum capability);
+    static void disable(GLenum capability);
+    static void blendFunc(GLenum sourceFactor, GLenum destinationFactor);
+    static void depthFunc(GLenum func);
+    static void depthMask(bool write);
+    static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // deleting an object silently reverts its bindings to 0 and frees the name for reuse,
+    // so deletions go through here to keep the cache from eliding a bind of a recycled name
+    static void deleteTextures(GLsizei count, const GLuint* textures);
+    static void deleteSamplers(GLsizei count, const GLuint* samplers);
+    static void deleteFramebuffers(GLsizei count, const GLuint* framebuffers);
+    static void deleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+
+    // forget everything, the next call of each kind is issued unconditionally
+    static void invalidate();
+
+    static const Stats& stats();
+    static void resetStats();
+    static const char* counterName(Counter counter);
+};
+#endif
@@ -0,0 +1,135 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    constexpr size_t InitialVertexCapacity = 1 << 16;
+    constexpr size_t InitialIndexCapacity = 1 << 18;
+
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    GLuint positionVAO = 0, positionVBO = 0;
+    size_t vertexCapacity = 0, indexCapacity = 0;
+    size_t vertexTop = 0, indexTop = 0;
+    std::unordered_map<const Mesh*, GeometryArena::Range> meshRanges;
+
+    void createVertexArray()
+    {
+        glCreateVertexArrays(1, &VAO);
+
+        const GLuint floatAttributes[] = { 0, 1, 2, 3, 4 };
+        const GLint sizes[] = { 3, 3, 2, 3, 3 };
+        const GLuint offsets[] = { offsetof(Vertex, Position), offsetof(Vertex, Normal), offsetof(Vertex, TexCoords),
+                                   offsetof(Vertex, Tangent), offsetof(Vertex, Bitangent) };
+        for (int i = 0; i < 5; i++)
+        {
+            glEnableVertexArrayAttrib(VAO, floatAttributes[i]);
+            glVertexArrayAttribFormat(VAO, floatAttributes[i], sizes[i], GL_FLOAT, GL_FALSE, offsets[i]);
+            glVertexArrayAttribBinding(VAO, floatAttributes[i], 0);
+        }
+        glEnableVertexArrayAttrib(VAO, 5);
+        glVertexArrayAttribIFormat(VAO, 5, 4, GL_INT, offsetof(Vertex, m_BoneIDs));
+        glVertexArrayAttribBinding(VAO, 5, 0);
+        glEnableVertexArrayAttrib(VAO, 6);
+        glVertexArrayAttribFormat(VAO, 6, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, m_Weights));
+        glVertexArrayAttribBinding(VAO, 6, 0);
+
+        glCreateVertexArrays(1, &positionVAO);
+        glEnableVertexArrayAttrib(positionVAO, 0);
+        glVertexArrayAttribFormat(positionVAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(positionVAO, 0, 0);
+    }
+
+    // replaces buffer with one of newSize bytes holding the first usedSize bytes of the old one
+    void grow(GLuint& buffer, size_t usedSize, size_t newSize)
+    {
+        GLuint grown;
+        glCreateBuffers(1, &grown);
+        glNamedBufferStorage(grown, newSize, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        if (buffer != 0)
+        {
+            if (usedSize > 0)
+                glCopyNamedBufferSubData(buffer, grown, 0, 0, usedSize);
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = grown;
+    }
+
+    void reserve(size_t vertices, size_t indices)
+    {
+        if (VAO == 0)
+            createVertexArray();
+
+        if (vertexTop + vertices > vertexCapacity)
+        {
+            size_t capacity = std::max(vertexCapacity, InitialVertexCapacity);
+            while (capacity < vertexTop + vertices)
+                capacity *= 2;
+            grow(VBO, vertexTop * sizeof(Vertex), capacity * sizeof(Vertex));
+            grow(positionVBO, vertexTop * sizeof(glm::vec3), capacity * sizeof(glm::vec3));
+            vertexCapacity = capacity;
+            glVertexArrayVertexBuffer(VAO, 0, VBO, 0, sizeof(Vertex));
+            glVertexArrayVertexBuffer(positionVAO, 0, positionVBO, 0, sizeof(glm::vec3));
+        }
+        if (indexTop + indices > indexCapacity)
+        {
+            size_t capacity = std::max(indexCapacity, InitialIndexCapacity);
+            while (capacity < indexTop + indices)
+                capacity *= 2;
+            grow(EBO, indexTop * sizeof(GLuint), capacity * sizeof(GLuint));
+            indexCapacity = capacity;
+            glVertexArrayElementBuffer(VAO, EBO);
+            glVertexArrayElementBuffer(positionVAO, EBO);
+        }
+    }
+}
+
+GeometryArena::Range GeometryArena::add(const Mesh& mesh)
+{
+    auto found = meshRanges.find(&mesh);
+    if (found != meshRanges.end())
+        return found->second;
+
+    reserve(mesh.vertices.size(), mesh.indices.size());
+
+    // indices stay mesh-relative, baseVertex moves them to the mesh's vertices
+    glNamedBufferSubData(VBO, vertexTop * sizeof(Vertex), mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data());
+    glNamedBufferSubData(EBO, indexTop * sizeof(GLuint), mesh.indices.size() * sizeof(GLuint), mesh.indices.data());
+    std::vector<glm::vec3> positions;
+    positions.reserve(mesh.vertices.size());
+    for (const Vertex& vertex : mesh.vertices)
+        positions.push_back(vertex.Position);
+    glNamedBufferSubData(positionVBO, vertexTop * sizeof(glm::vec3), positions.size() * sizeof(glm::vec3), positions.data());
+
+    const Range range = { static_cast<GLsizei>(mesh.indices.size()), static_cast<GLuint>(indexTop), static_cast<GLint>(vertexTop) };
+    vertexTop += mesh.vertices.size();
+    indexTop += mesh.indices.size();
+    meshRanges[&mesh] = range;
+    return range;
+}
+
+GLuint GeometryArena::vertexArray()
+{
+    if (VAO == 0)
+        createVertexArray();
+    return VAO;
+}
+
+GLuint GeometryArena::positionVertexArray()
+{
+    if (VAO == 0)
+        createVertexArray();
+    return positionVAO;
+}
+
+size_t GeometryArena::vertexCount()
+{
+    return vertexTop;
+}
+
+size_t GeometryArena::indexCount()
+{
+    return indexTop;
+}
@@ -0,0 +1,35 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include "Object/Mesh.h"
+
+#include <cstddef>
+
+// One vertex and one index buffer that static meshes are suballocated from, behind a single VAO with the
+// Mesh attribute layout (0..6), so any number of them can go out in one multi-draw. A second VAO reads the
+// same indices with only attribute 0, from a packed copy of the positions, for depth-only passes. Ranges are
+// only ever appended; when a buffer runs out it is reallocated at twice the size and the old contents copied
+// over.
+class GeometryArena
+{
+public:
+    // where a mesh lives in the arena, in the terms of DrawElementsIndirectCommand
+    struct Range
+    {
+        GLsizei indexCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+    };
+
+    // copies the mesh into the arena, once per mesh: adding it again returns the same range
+    static Range add(const Mesh& mesh);
+
+    static GLuint vertexArray();
+    static GLuint positionVertexArray(); // same ranges as vertexArray()
+
+    static size_t vertexCount();
+    static size_t indexCount();
+};
+#endif
@@ -0,0 +1,148 @@
+#include "InstanceCuller.h"
+#include "GLState.h"
+#include "StreamBuffer.h"
+#include "TextureUnits.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace
+{
+    constexpr GLuint WorkGroupSize = 64;
+
+    // sphere around the vertices of every mesh, centred on their bounding box
+    glm::vec4 boundingSphereOf(const Model& model)
+    {
+        glm::vec3 lower(std::numeric_limits<float>::max()), upper(std::numeric_limits<float>::lowest());
+        for (const Mesh& mesh : model.meshes)
+        {
+            for (const Vertex& vertex : mesh.vertices)
+            {
+                lower = glm::min(lower, vertex.Position);
+                upper = glm::max(upper, vertex.Position);
+            }
+        }
+        if (lower.x > upper.x)
+            return glm::vec4(0.0f);
+
+        const glm::vec3 center = (lower + upper) * 0.5f;
+        float radius = 0.0f;
+        for (const Mesh& mesh : model.meshes)
+            for (const Vertex& vertex : mesh.vertices)
+                radius = std::max(radius, glm::length(vertex.Position - center));
+        return glm::vec4(center, radius);
+    }
+}
+
+size_t InstanceCuller::add(const Model& model, const glm::mat4* instanceMatrices, GLuint count)
+{
+    sets.push_back({ &model, boundingSphereOf(model), totalInstances, count, commandsPerView });
+    matrices.insert(matrices.end(), instanceMatrices, instanceMatrices + count);
+    totalInstances += count;
+    commandsPerView += static_cast<GLuint>(model.meshes.size());
+    return sets.size() - 1;
+}
+
+void InstanceCuller::build()
+{
+    // commands of view v start at v * commandsPerView, its visible range at v * totalInstances
+    commandTemplate.clear();
+    for (GLuint view = 0; view < ViewCount; view++)
+    {
+        for (const Set& set : sets)
+        {
+            const GLuint visibleOffset = view * totalInstances + set.firstInstance;
+            for (const Mesh& mesh : set.model->meshes)
+                commandTemplate.push_back({ static_cast<GLuint>(mesh.getIndexCount()), 0, 0, 0, visibleOffset });
+        }
+    }
+
+    glCreateBuffers(1, &instances);
+    glNamedBufferStorage(instances, std::max<size_t>(matrices.size(), 1) * sizeof(glm::mat4), matrices.data(), 0);
+    glCreateBuffers(1, &visible);
+    glNamedBufferStorage(visible, std::max<GLuint>(totalInstances * ViewCount, 1) * sizeof(GLuint), nullptr, 0);
+    const std::vector<GLuint> nothingVisible(std::max<GLuint>(totalInstances, 1), 0);
+    glCreateBuffers(1, &visibility);
+    glNamedBufferStorage(visibility, nothingVisible.size() * sizeof(GLuint), nothingVisible.data(), 0);
+    glCreateBuffers(1, &commands);
+    glNamedBufferStorage(commands, std::max<size_t>(commandTemplate.size(), 1) * sizeof(DrawCommand), commandTemplate.data(),
+                         GL_DYNAMIC_STORAGE_BIT);
+    matrices = {};
+
+    cullShader = std::make_unique<Shader>("res/shaders/instancecull.comp");
+}
+
+void InstanceCuller::cull(View view, const Frustum& frustum)
+{
+    dispatch(view, frustum, FrustumOnly);
+}
+
+void InstanceCuller::cullEarly(const Frustum& frustum)
+{
+    dispatch(CameraView, frustum, EarlyPhase);
+}
+
+void InstanceCuller::cullLate(const Frustum& frustum, const glm::mat4& viewProjection, GLuint depthPyramid,
+                              const glm::vec2& pyramidScale)
+{
+    cullShader->setMat4("viewProjection", viewProjection);
+    cullShader->setVec2("pyramidScale", pyramidScale);
+    GLState::bindTexture(TextureUnit::DepthPyramid, depthPyramid);
+    dispatch(CameraLateView, frustum, LatePhase);
+}
+
+void InstanceCuller::dispatch(View view, const Frustum& frustum, Phase phase)
+{
+    if (sets.empty())
+        return;
+
+    const GLuint firstCommand = view * commandsPerView;
+    StreamBuffer::copyTo(commands, firstCommand * sizeof(DrawCommand), &commandTemplate[firstCommand],
+                         commandsPerView * sizeof(DrawCommand));
+
+    cullShader->use();
+    for (int i = 0; i < 6; i++)
+        cullShader->setVec4("frustumPlanes[" + std::to_string(i) + "]", frustum.planes[i]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBinding, instances);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VisibleBinding, visible);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CommandBinding, commands);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VisibilityBinding, visibility);
+    cullShader->setInt("phase", phase);
+
+    for (const Set& set : sets)
+    {
+        cullShader->setVec4("boundingSphere", set.boundingSphere);
+        cullShader->setInt("firstInstance", set.firstInstance);
+        cullShader->setInt("instanceCount", set.instanceCount);
+        cullShader->setInt("visibleOffset", view * totalInstances + set.firstInstance);
+        cullShader->setInt("firstCommand", firstCommand + set.firstCommand);
+        cullShader->setInt("commandCount", static_cast<int>(set.model->meshes.size()));
+        glDispatchCompute((set.instanceCount + WorkGroupSize - 1) / WorkGroupSize, 1, 1);
+    }
+}
+
+void InstanceCuller::bind() const
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstanceBinding, instances);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VisibleBinding, visible);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+}
+
+void InstanceCuller::draw(size_t set, View view, const Shader* materialShader) const
+{
+    const Model& model = *sets[set].model;
+    const std::vector<Mesh>& meshes = model.meshes;
+    for (size_t mesh = 0; mesh < meshes.size(); mesh++)
+    {
+        if (materialShader)
+            model.materials[meshes[mesh].materialIndex].apply(*materialShader);
+        GLState::bindVertexArray(materialShader ? meshes[mesh].VAO : meshes[mesh].positionVAO);
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(commandOffset(set, view, mesh)));
+    }
+}
+
+GLintptr InstanceCuller::commandOffset(size_t set, View view, size_t mesh) const
+{
+    return static_cast<GLintptr>((view * commandsPerView + sets[set].firstCommand + mesh) * sizeof(DrawCommand));
+}
@@ -0,0 +1,120 @@
+#ifndef INSTANCE_CULLER_H
+#define INSTANCE_CULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "CascadedShadowMap.h"
+#include "Frustum.h"
+#include "Object/Model.h"
+#include "Object/Shader.h"
+
+#include <memory>
+#include <vector>
+
+// Instanced models culled on the GPU. Each set (a model and its instance matrices) is tested per view by
+// instancecull.comp: instances whose bounding sphere survives the view's frustum have their index compacted
+// into the visible buffer, and the instance count of the set's DrawElementsIndirectCommands (one per mesh)
+// is the number of survivors. The commands' baseInstance points at the set's visible range, so instanced
+// vertex shaders fetch their matrix as instances[visible[gl_BaseInstance + gl_InstanceID]].
+//
+// The camera is culled in two phases against occlusion as well: cullEarly() keeps the instances that were
+// visible last frame, which are drawn and build a depth pyramid; cullLate() then tests every instance in the
+// frustum against that pyramid, remembers the result for the next frame, and yields those that are visible
+// but were not drawn early. Anything that comes out from behind an occluder is drawn in the same frame.
+class InstanceCuller
+{
+public:
+    // one frustum per pass drawing the instances; every view has its own visible range and commands
+    enum View
+    {
+        CameraView,
+        CameraLateView, // instances found visible by cullLate() that CameraView missed
+        PointLightView,                             // the first of six views, one per cube map face
+        DirectionalLightView = PointLightView + 6,  // the first of CascadedShadowMap::CascadeCount views, one per cascade
+        ViewCount = DirectionalLightView + CascadedShadowMap::CascadeCount
+    };
+
+    static View cubeFaceView(int face) { return static_cast<View>(PointLightView + face); }
+    static View cascadeView(int cascade) { return static_cast<View>(DirectionalLightView + cascade); }
+
+    // must match instancecull.comp and the instanced vertex shaders
+    static constexpr GLuint InstanceBinding = 4;
+    static constexpr GLuint VisibleBinding = 5;
+    static constexpr GLuint CommandBinding = 6;
+    static constexpr GLuint VisibilityBinding = 7;
+
+    // registers instances of a model, returns the set; call before build()
+    size_t add(const Model& model, const glm::mat4* matrices, GLuint count);
+
+    // uploads the instances and creates the buffers and the cull program
+    void build();
+
+    // resets the view's instance counts and culls every set against the frustum
+    void cull(View view, const Frustum& frustum);
+
+    // CameraView: the instances in the frustum that were visible last frame
+    void cullEarly(const Frustum& frustum);
+
+    // CameraLateView: instances in the frustum not hidden behind depthPyramid (see DepthPyramid) that
+    // cullEarly() left out; records what is visible for the next cullEarly(). pyramidScale is the part of
+    // the pyramid the screen covers, in texture coordinates, below 1 when the scene renders to a corner of it
+    void cullLate(const Frustum& frustum, const glm::mat4& viewProjection, GLuint depthPyramid,
+                  const glm::vec2& pyramidScale = glm::vec2(1.0f));
+
+    // binds the instance and visible buffers and makes the commands the GL_DRAW_INDIRECT_BUFFER
+    void bind() const;
+
+    // one indirect draw per mesh of the set, with whatever program is in use; call bind() first. With a
+    // materialShader each mesh's material is applied for it, without one the draws are depth only and read
+    // the meshes' position streams
+    void draw(size_t set, View view, const Shader* materialShader = nullptr) const;
+
+    // byte offset of the command of one mesh in commandBuffer()
+    GLintptr commandOffset(size_t set, View view, size_t mesh) const;
+
+    GLuint commandBuffer() const { return commands; }
+    GLuint visibleBuffer() const { return visible; }
+    GLuint visibilityBuffer() const { return visibility; }
+    GLuint instanceCount() const { return totalInstances; }
+
+private:
+    // how instancecull.comp decides
+    enum Phase
+    {
+        FrustumOnly,
+        EarlyPhase,
+        LatePhase
+    };
+
+    void dispatch(View view, const Frustum& frustum, Phase phase);
+
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    struct Set
+    {
+        const Model* model;
+        glm::vec4 boundingSphere;
+        GLuint firstInstance;
+        GLuint instanceCount;
+        GLuint firstCommand; // within a view
+    };
+
+    std::vector<Set> sets;
+    std::vector<glm::mat4> matrices;
+    std::vector<DrawCommand> commandTemplate; // every view, instance counts zero
+    GLuint totalInstances = 0;
+    GLuint commandsPerView = 0;
+
+    GLuint instances = 0, visible = 0, commands = 0;
+    GLuint visibility = 0; // per instance, visible to the camera last frame
+    std::unique_ptr<Shader> cullShader;
+};
+#endif
@@ -0,0 +1,107 @@
+#include "LightClusters.h"
+#include "FrameSync.h"
+#include "StreamBuffer.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // lightcull.comp runs one invocation per cluster, a work group covers four depth slices
+    constexpr GLuint SlicesPerGroup = 4;
+}
+
+LightClusters::Light LightClusters::pointLight(const glm::vec3& position, const glm::vec3& color, float range)
+{
+    return { position, range, color, -1.0f, glm::vec3(0.0f, -1.0f, 0.0f), -1.0f };
+}
+
+LightClusters::Light LightClusters::spotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float range,
+                                              float innerAngle, float outerAngle)
+{
+    return { position, range, color, std::cos(glm::radians(innerAngle)), glm::normalize(direction), std::cos(glm::radians(outerAngle)) };
+}
+
+void LightClusters::upload(const std::vector<Light>& sceneLights)
+{
+    if (grid == 0)
+    {
+        glCreateBuffers(1, &grid);
+        glNamedBufferStorage(grid, GridX * GridY * GridZ * 2 * sizeof(GLuint), nullptr, 0);
+        glCreateBuffers(1, &indices);
+        glNamedBufferStorage(indices, MaxLightIndices * sizeof(GLuint), nullptr, 0);
+
+        // read on the CPU once the frame that wrote them is done, ranges bound at storage alignment
+        counterStride = (sizeof(Counters) + StreamBuffer::storageAlignment() - 1) / StreamBuffer::storageAlignment()
+                      * StreamBuffer::storageAlignment();
+        const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &counters);
+        glNamedBufferStorage(counters, FrameSync::MaxFramesInFlight * counterStride, nullptr, flags);
+        mappedCounters = static_cast<unsigned char*>(glMapNamedBufferRange(counters, 0, FrameSync::MaxFramesInFlight * counterStride, flags));
+    }
+
+    // into this frame's stream region; an empty range cannot be bound, so there is always room for one light
+    count = static_cast<GLuint>(sceneLights.size());
+    lightsSize = std::max<size_t>(1, count) * sizeof(Light);
+    const StreamBuffer::Allocation allocation = StreamBuffer::allocate(lightsSize, StreamBuffer::storageAlignment());
+    if (count > 0)
+        std::memcpy(allocation.data, sceneLights.data(), count * sizeof(Light));
+    lights = allocation.buffer;
+    lightsOffset = allocation.offset;
+}
+
+void LightClusters::cull(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, GLsizei width, GLsizei height)
+{
+    if (!cullShader)
+        cullShader = std::make_unique<Shader>("res/shaders/lightcull.comp");
+
+    // fragments find their slice as log(depth) * depthScale - depthBias
+    const float logRange = std::log(farPlane / nearPlane);
+    depthScale = GridZ / logRange;
+    depthBias = GridZ * std::log(nearPlane) / logRange;
+    tileSize = glm::vec2(static_cast<float>(width) / GridX, static_cast<float>(height) / GridY);
+
+    // the slot was last written MaxFramesInFlight culls ago, FrameSync has waited for that frame
+    const GLintptr slot = static_cast<GLintptr>(culls++ % FrameSync::MaxFramesInFlight) * counterStride;
+    if (culls > FrameSync::MaxFramesInFlight)
+    {
+        Counters result;
+        std::memcpy(&result, mappedCounters + slot, sizeof(Counters));
+        if (result.droppedLights > 0 && dropped == 0)
+            spdlog::warn("[LightClusters] the clusters asked for {} light indices, {} fit: dropped {} lights", result.requestedIndices,
+                         MaxLightIndices, result.droppedLights);
+        requested = result.requestedIndices;
+        dropped = result.droppedLights;
+    }
+    const GLuint zero = 0;
+    glClearNamedBufferSubData(counters, GL_R32UI, slot, sizeof(Counters), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    const float tanHalfY = std::tan(fovY * 0.5f);
+    cullShader->use();
+    cullShader->setMat4("view", view);
+    cullShader->setInt("lightCount", static_cast<int>(count));
+    cullShader->setVec2("tanHalfFov", glm::vec2(tanHalfY * aspect, tanHalfY));
+    cullShader->setFloat("zNear", nearPlane);
+    cullShader->setFloat("zFar", farPlane);
+    bind();
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, CounterBinding, counters, slot, sizeof(Counters));
+    glDispatchCompute(1, 1, GridZ / SlicesPerGroup);
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+}
+
+void LightClusters::bind() const
+{
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LightBinding, lights, lightsOffset, lightsSize);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GridBinding, grid);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndexBinding, indices);
+}
+
+void LightClusters::apply(Shader& shader) const
+{
+    shader.setVec2("clusterTileSize", tileSize);
+    shader.setFloat("clusterDepthScale", depthScale);
+    shader.setFloat("clusterDepthBias", depthBias);
+}
@@ -0,0 +1,87 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Object/Shader.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Clustered forward shading: every point and spot light lives in one storage buffer, and lightcull.comp bins
+// them into a grid of froxels over the view frustum (GridX x GridY screen tiles, GridZ slices spaced
+// exponentially in view depth). Each cluster keeps the indices of the lights whose range reaches it, so
+// object.frag only loops over the lights near the fragment instead of all of them. The indices of all
+// clusters share one list of MaxLightIndices entries, each cluster reserves its range with an atomic; lights
+// that no longer fit are dropped, counted, and the counts read back a few frames later.
+//
+// Light 0 is the one with the cube map shadow.
+class LightClusters
+{
+public:
+    // std430 layout of Light in lightcull.comp and object.frag; point lights have spotCosOuter = -1
+    struct Light
+    {
+        glm::vec3 position;
+        float range;        // the light is windowed to zero here
+        glm::vec3 color;
+        float spotCosInner;
+        glm::vec3 direction;
+        float spotCosOuter;
+    };
+
+    // must match lightcull.comp and object.frag
+    static constexpr GLuint GridX = 16, GridY = 9, GridZ = 24;
+    static constexpr GLuint MaxLightIndices = GridX * GridY * GridZ * 32;
+    static constexpr GLuint LightBinding = 8;
+    static constexpr GLuint GridBinding = 9;
+    static constexpr GLuint IndexBinding = 10;
+    static constexpr GLuint CounterBinding = 11;
+
+    static Light pointLight(const glm::vec3& position, const glm::vec3& color, float range);
+    static Light spotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float range,
+                           float innerAngle, float outerAngle); // angles in degrees
+
+    // replaces the lights for this frame, written into the stream buffer
+    void upload(const std::vector<Light>& lights);
+
+    // bins the lights into the clusters of a perspective view rendered at width x height; once per frame
+    void cull(const glm::mat4& view, float fovY, float aspect, float nearPlane, float farPlane, GLsizei width, GLsizei height);
+
+    // binds the light, count and index buffers for shading
+    void bind() const;
+
+    // what object.frag needs to find the cluster of a fragment
+    void apply(Shader& shader) const;
+
+    GLuint lightBuffer() const { return lights; } // the stream buffer, the lights start at an offset
+    GLuint gridBuffer() const { return grid; }
+    GLuint indexBuffer() const { return indices; }
+    GLuint lightCount() const { return count; }
+    // of the latest cull the GPU finished: index list entries the clusters asked for, and lights dropped
+    GLuint requestedIndices() const { return requested; }
+    GLuint droppedLights() const { return dropped; }
+
+private:
+    // lightcull.comp's LightCounters, one per frame in flight
+    struct Counters
+    {
+        GLuint requestedIndices;
+        GLuint droppedLights;
+    };
+
+    GLuint lights = 0, grid = 0, indices = 0, counters = 0;
+    unsigned char* mappedCounters = nullptr;
+    size_t counterStride = 0;
+    uint64_t culls = 0;
+    GLuint requested = 0, dropped = 0;
+    GLintptr lightsOffset = 0;
+    size_t lightsSize = 0;
+    GLuint count = 0;
+    glm::vec2 tileSize = glm::vec2(1.0f);
+    float depthScale = 0.0f, depthBias = 0.0f;
+    std::unique_ptr<Shader> cullShader;
+};
+#endif
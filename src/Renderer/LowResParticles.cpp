@@ -0,0 +1,61 @@
+#include "LowResParticles.h"
+#include "GLState.h"
+#include "TextureUnits.h"
+
+#include <glm/glm.hpp>
+
+RenderTargetPool::Desc LowResParticles::colorDesc(GLsizei renderWidth, GLsizei renderHeight) const
+{
+    return { width(renderWidth), height(renderHeight), GL_RGBA16F };
+}
+
+RenderTargetPool::Desc LowResParticles::depthDesc(GLsizei renderWidth, GLsizei renderHeight) const
+{
+    return { width(renderWidth), height(renderHeight), GL_DEPTH_COMPONENT24, RenderTargetPool::DepthAttachment };
+}
+
+RenderTargetPool::Desc LowResParticles::depthCopyDesc(GLsizei renderWidth, GLsizei renderHeight) const
+{
+    return { width(renderWidth), height(renderHeight), GL_R32F };
+}
+
+void LowResParticles::downsampleDepth(GLuint sceneDepth)
+{
+    if (!downsampleShader)
+    {
+        downsampleShader = std::make_unique<Shader>("res/shaders/post.vert", "res/shaders/particledepth.frag");
+        compositeShader = std::make_unique<Shader>("res/shaders/post.vert", "res/shaders/particlecomposite.frag");
+        glCreateVertexArrays(1, &emptyVertexArray);
+    }
+
+    downsampleShader->use();
+    downsampleShader->setInt("divisor", divisor);
+    GLState::bindTexture(TextureUnit::SceneDepth, sceneDepth);
+
+    // every texel gets written, through gl_FragDepth
+    GLState::depthFunc(GL_ALWAYS);
+    GLState::bindVertexArray(emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GLState::depthFunc(GL_LESS);
+}
+
+void LowResParticles::composite(GLuint particles, GLuint particleDepth, GLuint sceneDepth, float zNear, float zFar,
+                                GLsizei renderWidth, GLsizei renderHeight)
+{
+    compositeShader->use();
+    compositeShader->setFloat("zNear", zNear);
+    compositeShader->setFloat("zFar", zFar);
+    compositeShader->setInt("divisor", divisor);
+    compositeShader->setVec2("extent", glm::vec2(width(renderWidth), height(renderHeight)));
+    GLState::bindTexture(TextureUnit::ParticleColor, particles);
+    GLState::bindTexture(TextureUnit::ParticleDepth, particleDepth);
+    GLState::bindTexture(TextureUnit::SceneDepth, sceneDepth);
+
+    GLState::disable(GL_DEPTH_TEST);
+    GLState::enable(GL_BLEND);
+    GLState::blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::bindVertexArray(emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GLState::disable(GL_BLEND);
+    GLState::enable(GL_DEPTH_TEST);
+}
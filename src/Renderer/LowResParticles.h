@@ -0,0 +1,47 @@
+#ifndef LOW_RES_PARTICLES_H
+#define LOW_RES_PARTICLES_H
+
+#include <glad/glad.h>
+
+#include "RenderTargetPool.h"
+#include "Object/Shader.h"
+
+#include <memory>
+
+// Particles drawn off-screen at a fraction of the render resolution, so their fill rate drops with the
+// square of the divisor. They are depth tested against a copy of the scene depth downsampled to their size,
+// keeping the nearest depth of each block so a particle never shows through the edge of an occluder, then
+// composited over the scene color with a bilateral upsample: each pixel blends the four low resolution
+// texels around it, weighted by how close their depth is to its own, so colors do not bleed across depth
+// edges into halos.
+class LowResParticles
+{
+public:
+    // 1 draws the particles at full resolution straight into the scene, 2 at half, 4 at quarter
+    int divisor = 1;
+
+    bool enabled() const { return divisor > 1; }
+    GLsizei width(GLsizei renderWidth) const { return (renderWidth + divisor - 1) / divisor; }
+    GLsizei height(GLsizei renderHeight) const { return (renderHeight + divisor - 1) / divisor; }
+
+    // the particles' color, depth attachment, and that depth again as a color the upsample can compare
+    RenderTargetPool::Desc colorDesc(GLsizei renderWidth, GLsizei renderHeight) const;
+    RenderTargetPool::Desc depthDesc(GLsizei renderWidth, GLsizei renderHeight) const;
+    RenderTargetPool::Desc depthCopyDesc(GLsizei renderWidth, GLsizei renderHeight) const;
+
+    // into the bound framebuffer (a depthCopyDesc color and a depthDesc depth): the nearest scene depth of
+    // every divisor x divisor block
+    void downsampleDepth(GLuint sceneDepth);
+
+    // blends the particles (premultiplied by their coverage) over the bound full resolution scene color;
+    // depths are linearized between zNear and zFar for the comparison. The particles fill the
+    // width(renderWidth) x height(renderHeight) corner of their targets
+    void composite(GLuint particles, GLuint particleDepth, GLuint sceneDepth, float zNear, float zFar,
+                   GLsizei renderWidth, GLsizei renderHeight);
+
+private:
+    std::unique_ptr<Shader> downsampleShader;
+    std::unique_ptr<Shader> compositeShader;
+    GLuint emptyVertexArray = 0;
+};
+#endif
@@ -0,0 +1,232 @@
+#include "MaterialTable.h"
+#include "GLState.h"
+
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_set>
+
+namespace
+{
+    // GL_ARB_bindless_texture is not part of the generated loader, fetch the two entry points we need
+    typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+    typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+    PFNGLGETTEXTUREHANDLEARBPROC glGetTextureHandleARB = nullptr;
+    PFNGLMAKETEXTUREHANDLERESIDENTARBPROC glMakeTextureHandleResidentARB = nullptr;
+
+    // std430 layout of MaterialRecord in object.frag: a uvec2 per map, either a bindless handle or (page, layer)
+    struct Record
+    {
+        GLuint maps[MATERIAL_MAP_COUNT][2];
+    };
+
+    // textures can share a page only if every level has the same size and format and they sample alike
+    typedef std::tuple<GLint, GLint, GLint, GLint, GLint, GLint> PageKey; // width, height, format, levels, wrap, min filter
+
+    MaterialTable::Mode activeMode = MaterialTable::Discrete;
+    std::vector<Material> materials;
+    size_t uploadedCount = 0;
+    GLuint buffer = 0;
+    std::vector<GLuint> pages;
+    std::unordered_set<GLuint64> residentHandles;
+
+    bool loadBindless()
+    {
+        if (!glfwExtensionSupported("GL_ARB_bindless_texture"))
+            return false;
+        glGetTextureHandleARB = reinterpret_cast<PFNGLGETTEXTUREHANDLEARBPROC>(glfwGetProcAddress("glGetTextureHandleARB"));
+        glMakeTextureHandleResidentARB = reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(glfwGetProcAddress("glMakeTextureHandleResidentARB"));
+        return glGetTextureHandleARB && glMakeTextureHandleResidentARB;
+    }
+
+    PageKey pageKeyFor(GLuint texture)
+    {
+        GLint width = 0, height = 0, format = 0, levels = 0, wrap = 0, minFilter = 0;
+        glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+        glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+        glGetTextureParameteriv(texture, GL_TEXTURE_WRAP_S, &wrap);
+        glGetTextureParameteriv(texture, GL_TEXTURE_MIN_FILTER, &minFilter);
+        return { width, height, format, levels, wrap, minFilter };
+    }
+
+    void fillBindlessRecords(std::vector<Record>& records)
+    {
+        for (size_t i = 0; i < materials.size(); i++)
+        {
+            for (int map = 0; map < MATERIAL_MAP_COUNT; map++)
+            {
+                const GLuint64 handle = glGetTextureHandleARB(materials[i].textures[map]);
+                if (residentHandles.insert(handle).second)
+                    glMakeTextureHandleResidentARB(handle);
+                records[i].maps[map][0] = static_cast<GLuint>(handle & 0xFFFFFFFFu);
+                records[i].maps[map][1] = static_cast<GLuint>(handle >> 32);
+            }
+        }
+    }
+
+    // pages are rebuilt from scratch; this only runs while the scene is loading
+    void fillArrayRecords(std::vector<Record>& records)
+    {
+        GLState::deleteTextures(static_cast<GLsizei>(pages.size()), pages.data());
+        pages.clear();
+
+        // the neutral maps of a default material go first, so their page is always among the bound ones and
+        // textures left without a page can fall back to them
+        const Material neutral;
+        std::map<PageKey, std::vector<GLuint>> groups;
+        std::map<GLuint, std::pair<GLuint, GLuint>> locations; // texture -> (page, layer)
+        const auto place = [&](GLuint texture)
+        {
+            if (locations.count(texture))
+                return;
+            std::vector<GLuint>& group = groups[pageKeyFor(texture)];
+            locations[texture] = { 0, static_cast<GLuint>(group.size()) };
+            group.push_back(texture);
+        };
+        for (GLuint texture : neutral.textures)
+            place(texture);
+        for (const Material& material : materials)
+            for (GLuint texture : material.textures)
+                place(texture);
+
+        std::vector<PageKey> order = { pageKeyFor(neutral.textures[0]) };
+        for (const auto& group : groups)
+            if (group.first != order.front())
+                order.push_back(group.first);
+
+        std::unordered_set<GLuint> unplaced;
+        for (const PageKey& key : order)
+        {
+            const std::vector<GLuint>& textures = groups[key];
+            const auto [width, height, format, levels, wrap, minFilter] = key;
+            const GLuint pageIndex = static_cast<GLuint>(pages.size());
+            if (pageIndex >= MaterialTable::MaxPages)
+            {
+                std::cout << "[MaterialTable] no texture array page left for " << textures.size() << " texture(s) of "
+                          << width << "x" << height << " (only " << MaterialTable::MaxPages
+                          << " are bound); their materials sample the default maps instead" << std::endl;
+                unplaced.insert(textures.begin(), textures.end());
+                continue;
+            }
+
+            GLuint page;
+            glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &page);
+            glTextureStorage3D(page, levels, format, width, height, static_cast<GLsizei>(textures.size()));
+            glTextureParameteri(page, GL_TEXTURE_WRAP_S, wrap);
+            glTextureParameteri(page, GL_TEXTURE_WRAP_T, wrap);
+            glTextureParameteri(page, GL_TEXTURE_MIN_FILTER, minFilter);
+            glTextureParameteri(page, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            for (GLuint layer = 0; layer < textures.size(); layer++)
+            {
+                for (GLint level = 0; level < levels; level++)
+                {
+                    const GLsizei levelWidth = std::max(1, width >> level);
+                    const GLsizei levelHeight = std::max(1, height >> level);
+                    glCopyImageSubData(textures[layer], GL_TEXTURE_2D, level, 0, 0, 0,
+                                       page, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                                       levelWidth, levelHeight, 1);
+                }
+                locations[textures[layer]].first = pageIndex;
+            }
+            pages.push_back(page);
+        }
+
+        for (size_t i = 0; i < materials.size(); i++)
+        {
+            for (int map = 0; map < MATERIAL_MAP_COUNT; map++)
+            {
+                GLuint texture = materials[i].textures[map];
+                if (unplaced.count(texture))
+                    texture = neutral.textures[map];
+                const auto [page, layer] = locations[texture];
+                records[i].maps[map][0] = page;
+                records[i].maps[map][1] = layer;
+            }
+        }
+    }
+
+    void upload()
+    {
+        std::vector<Record> records(std::max<size_t>(materials.size(), 1));
+        if (activeMode == MaterialTable::Bindless)
+            fillBindlessRecords(records);
+        else
+            fillArrayRecords(records);
+
+        glDeleteBuffers(1, &buffer);
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, records.size() * sizeof(Record), records.data(), 0);
+        uploadedCount = materials.size();
+    }
+}
+
+void MaterialTable::init(Mode requested)
+{
+    activeMode = requested;
+    if (activeMode == Bindless && !loadBindless())
+    {
+        std::cout << "[MaterialTable] GL_ARB_bindless_texture not available, falling back to texture arrays" << std::endl;
+        activeMode = TextureArrays;
+    }
+}
+
+MaterialTable::Mode MaterialTable::mode()
+{
+    return activeMode;
+}
+
+const char* MaterialTable::modeName(Mode mode)
+{
+    switch (mode)
+    {
+    case Bindless:      return "bindless";
+    case TextureArrays: return "texture arrays";
+    default:            return "discrete";
+    }
+}
+
+bool MaterialTable::mixedMaterialDraws()
+{
+    switch (activeMode)
+    {
+    case Bindless:      return glfwExtensionSupported("GL_NV_gpu_shader5");
+    case TextureArrays: return true;
+    default:            return false;
+    }
+}
+
+GLuint MaterialTable::add(const Material& material)
+{
+    materials.push_back(material);
+    return static_cast<GLuint>(materials.size() - 1);
+}
+
+void MaterialTable::bind()
+{
+    if (activeMode == Discrete)
+        return;
+    if (uploadedCount != materials.size() || buffer == 0)
+        upload();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding, buffer);
+    for (GLuint i = 0; i < pages.size(); i++)
+        GLState::bindTexture(FirstPageUnit + i, pages[i]);
+}
+
+std::vector<SpecializationConstant> MaterialTable::shaderConstants()
+{
+    switch (activeMode)
+    {
+    case Bindless:
+        return { { 1, 1, "MATERIAL_TABLE" }, { 2, 1, "MATERIAL_BINDLESS" } };
+    case TextureArrays:
+        return { { 1, 1, "MATERIAL_TABLE" } };
+    default:
+        return {};
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include <glad/glad.h>
+
+#include "Object/Material.h"
+#include "TextureUnits.h"
+
+#include <vector>
+
+// Every loaded material as one record in a shader storage buffer, so shaders can pick a material by ID
+// instead of relying on whatever is bound to units 0-4.
+//
+// Bindless: records hold resident GL_ARB_bindless_texture handles, nothing is bound per draw.
+// TextureArrays: the fallback where the extension is missing (Mesa llvmpipe, older drivers); textures
+//                of equal size, format and sampling are copied into GL_TEXTURE_2D_ARRAY pages bound once
+//                to fixed units, and records hold (page, layer) pairs.
+// Discrete: no table, materials bind their own textures (Material::bind).
+class MaterialTable
+{
+public:
+    enum Mode
+    {
+        Discrete,
+        Bindless,
+        TextureArrays
+    };
+
+    // must match object.frag
+    static constexpr GLuint StorageBinding = 2;
+    static constexpr GLuint FirstPageUnit = TextureUnit::MaterialPages;
+    // units 24-31; textures that would need a page beyond these sample the default maps (see Material)
+    static constexpr GLuint MaxPages = 8;
+
+    // picks the requested mode, stepping down from Bindless to TextureArrays if the extension is missing;
+    // call once the GL context exists and before creating the shaders that sample materials
+    static void init(Mode requested);
+    static Mode mode();
+    static const char* modeName(Mode mode);
+
+    // whether one draw may mix materials (per-vertex IDs): always with texture arrays, with bindless handles
+    // only where sampling through non-uniform handles is allowed (GL_NV_gpu_shader5)
+    static bool mixedMaterialDraws();
+
+    // registers a material and returns its ID, the index of its record
+    static GLuint add(const Material& material);
+
+    // uploads records added since the last call and binds the buffer (and pages)
+    static void bind();
+
+    // defines/specialization constants selecting the table in object.frag
+    static std::vector<SpecializationConstant> shaderConstants();
+};
+#endif
@@ -0,0 +1,88 @@
+#include "PostProcess.h"
+#include "GLState.h"
+#include "TextureUnits.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace
+{
+    // must match post.frag
+    constexpr int LutSize = 32;
+}
+
+Shader& PostProcess::program(unsigned int combination)
+{
+    auto found = programs.find(combination);
+    if (found != programs.end())
+        return *found->second;
+
+    const std::vector<SpecializationConstant> constants = {
+        { 0, (combination & Bloom) ? 1u : 0u, "BLOOM" },
+        { 1, (combination & Vignette) ? 1u : 0u, "VIGNETTE" },
+        { 2, (combination & ColorGrading) ? 1u : 0u, "COLOR_GRADING" },
+        { 3, (combination & Fxaa) ? 1u : 0u, "FXAA" },
+        { 4, (combination & Upscale) ? 1u : 0u, "UPSCALE" }
+    };
+    auto& shader = programs[combination];
+    shader = std::make_unique<Shader>("res/shaders/post.vert", "res/shaders/post.frag", nullptr, nullptr, constants);
+    return *shader;
+}
+
+void PostProcess::createLut()
+{
+    std::vector<GLubyte> texels;
+    texels.reserve(LutSize * LutSize * LutSize * 3);
+    for (int b = 0; b < LutSize; b++)
+        for (int g = 0; g < LutSize; g++)
+            for (int r = 0; r < LutSize; r++)
+            {
+                const glm::vec3 color = glm::vec3(r, g, b) / float(LutSize - 1);
+                const glm::vec3 contrast = glm::mix(color, color * color * (3.0f - 2.0f * color), 0.35f);
+                const glm::vec3 graded = glm::clamp(contrast * glm::vec3(1.04f, 1.0f, 0.94f), 0.0f, 1.0f);
+                for (int channel = 0; channel < 3; channel++)
+                    texels.push_back(static_cast<GLubyte>(graded[channel] * 255.0f + 0.5f));
+            }
+
+    glCreateTextures(GL_TEXTURE_3D, 1, &lut);
+    glTextureStorage3D(lut, 1, GL_RGB8, LutSize, LutSize, LutSize);
+    glTextureSubImage3D(lut, 0, 0, 0, 0, LutSize, LutSize, LutSize, GL_RGB, GL_UNSIGNED_BYTE, texels.data());
+    glTextureParameteri(lut, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(lut, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(lut, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(lut, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(lut, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+void PostProcess::apply(GLuint sceneColor, GLuint bloomChain, GLuint bloomSampler, const glm::vec2& uvScale)
+{
+    if (lut == 0)
+    {
+        createLut();
+        glCreateVertexArrays(1, &emptyVertexArray);
+    }
+
+    unsigned int combination = features & ~Upscale;
+    if (uvScale != glm::vec2(1.0f))
+        combination |= Upscale;
+    Shader& shader = program(combination);
+    shader.use();
+    shader.setFloat("exposure", exposure);
+    shader.setFloat("vignetteStrength", vignetteStrength);
+    shader.setVec2("uvScale", uvScale);
+
+    GLState::bindTexture(TextureUnit::SceneColor, sceneColor);
+    if (enabled(Bloom))
+    {
+        GLState::bindTexture(TextureUnit::BloomSource, bloomChain);
+        GLState::bindSampler(TextureUnit::BloomSource, bloomSampler);
+    }
+    if (enabled(ColorGrading))
+        GLState::bindTexture(TextureUnit::ColorGradingLut, lut);
+
+    // one triangle over the screen, post.vert makes it from gl_VertexID
+    GLState::bindVertexArray(emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GLState::bindSampler(TextureUnit::BloomSource, 0);
+}
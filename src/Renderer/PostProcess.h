@@ -0,0 +1,51 @@
+#ifndef POST_PROCESS_H
+#define POST_PROCESS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Object/Shader.h"
+
+#include <memory>
+#include <unordered_map>
+
+// Everything between the HDR scene and the backbuffer in one full-screen pass (post.frag): bloom composite,
+// exposure tonemap and gamma, then a vignette, color grading through a 3D LUT and FXAA. FXAA needs its
+// neighbours graded too, so it repeats the per-pixel chain on the few taps it takes, which stay in the
+// texture cache; the HDR scene is read once and the backbuffer written once.
+//
+// Each feature is a specialization constant, the program of every combination in use is built on first use.
+// A scene rendered below the output resolution is upscaled in the same pass (Upscale, set by apply).
+class PostProcess
+{
+public:
+    enum Feature : unsigned int
+    {
+        Bloom        = 1 << 0,
+        Vignette     = 1 << 1,
+        ColorGrading = 1 << 2,
+        Fxaa         = 1 << 3,
+        Upscale      = 1 << 4
+    };
+
+    unsigned int features = Bloom | Vignette | ColorGrading | Fxaa;
+    float exposure = 1.0f;
+    float vignetteStrength = 0.35f;
+
+    bool enabled(Feature feature) const { return (features & feature) != 0; }
+
+    // the combined pass into the bound framebuffer; bloomChain (level 0 sampled bilinear through bloomSampler)
+    // is only read with Bloom on. uvScale is the corner of sceneColor and bloomChain the scene was rendered
+    // to; below 1 it is stretched over the viewport with a bicubic filter instead of a bilinear one
+    void apply(GLuint sceneColor, GLuint bloomChain, GLuint bloomSampler, const glm::vec2& uvScale = glm::vec2(1.0f));
+
+private:
+    Shader& program(unsigned int combination);
+    // the built-in grade: a gentle contrast curve and a slightly warm balance
+    void createLut();
+
+    std::unordered_map<unsigned int, std::unique_ptr<Shader>> programs;
+    GLuint lut = 0;
+    GLuint emptyVertexArray = 0;
+};
+#endif
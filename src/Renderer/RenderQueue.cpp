@@ -0,0 +1,147 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    constexpr float MaxSortDepth = 100.0f; // the camera's far plane
+
+    uint64_t makeKey(uint8_t pass, GLuint program, uint32_t material, GLuint vertexArray, float depth)
+    {
+        const float normalized = std::clamp(depth / MaxSortDepth, 0.0f, 1.0f);
+        const uint64_t quantizedDepth = static_cast<uint64_t>(normalized * 0xFFFF);
+        return (static_cast<uint64_t>(pass & 0xF) << 60) |
+               (static_cast<uint64_t>(program & 0xFFF) << 48) |
+               (static_cast<uint64_t>(material & 0xFFFF) << 32) |
+               (static_cast<uint64_t>(vertexArray & 0xFFFF) << 16) |
+               quantizedDepth;
+    }
+}
+
+void RenderQueue::submit(uint8_t pass, Shader& shader, const Material* material, GLuint vertexArray, GLsizei indexCount,
+                         GLsizei instanceCount, const glm::mat4* model, float depth)
+{
+    int32_t transform = -1;
+    if (model)
+    {
+        transform = static_cast<int32_t>(transforms.size());
+        transforms.push_back(*model);
+    }
+
+    // material 0 in the key means "none", table IDs are shifted by one
+    const uint32_t materialKey = material ? material->id + 1 : 0;
+    items.push_back({ makeKey(pass, shader.ID, materialKey, vertexArray, depth), static_cast<uint32_t>(packets.size()) });
+    packets.push_back({ &shader, material, vertexArray, indexCount, instanceCount, transform, 0, 0 });
+}
+
+void RenderQueue::submitIndirect(uint8_t pass, Shader& shader, const Material* material, GLuint vertexArray,
+                                 GLuint indirectBuffer, GLintptr offset, float depth)
+{
+    const uint32_t materialKey = material ? material->id + 1 : 0;
+    items.push_back({ makeKey(pass, shader.ID, materialKey, vertexArray, depth), static_cast<uint32_t>(packets.size()) });
+    packets.push_back({ &shader, material, vertexArray, 0, 0, -1, indirectBuffer, offset });
+}
+
+void RenderQueue::sort()
+{
+    // LSD radix sort over the key bytes; a byte every key shares is skipped
+    scratch.resize(items.size());
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        std::array<uint32_t, 256> offsets = {};
+        for (const SortItem& item : items)
+            offsets[(item.key >> shift) & 0xFF]++;
+        if (std::any_of(offsets.begin(), offsets.end(), [&](uint32_t count) { return count == items.size(); }))
+            continue;
+
+        uint32_t sum = 0;
+        for (uint32_t& offset : offsets)
+        {
+            const uint32_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (const SortItem& item : items)
+            scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+}
+
+void RenderQueue::execute(uint8_t pass)
+{
+    const uint64_t passBits = static_cast<uint64_t>(pass & 0xF) << 60;
+    auto begin = std::lower_bound(items.begin(), items.end(), passBits,
+                                  [](const SortItem& item, uint64_t key) { return item.key < key; });
+
+    // once per frame, unless packets were added since
+    if (uploadedTransforms != transforms.size())
+    {
+        const StreamBuffer::Allocation allocation = StreamBuffer::upload(transforms.data(), transforms.size() * sizeof(glm::mat4),
+                                                                         StreamBuffer::storageAlignment());
+        transformBuffer = allocation.buffer;
+        transformOffset = allocation.offset;
+        uploadedTransforms = transforms.size();
+    }
+    if (uploadedTransforms > 0)
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, TransformBinding, transformBuffer, transformOffset, uploadedTransforms * sizeof(glm::mat4));
+
+    const Shader* shader = nullptr;
+    const Material* material = nullptr;
+    GLuint vertexArray = 0;
+    GLuint indirectBuffer = 0;
+    for (auto it = begin; it != items.end() && (it->key >> 60) == (passBits >> 60); ++it)
+    {
+        const Packet& packet = packets[it->packet];
+        frameStats.packets++;
+
+        if (packet.shader != shader)
+        {
+            shader = packet.shader;
+            packet.shader->use();
+            // materials may resolve differently per program
+            material = nullptr;
+            frameStats.programs++;
+        }
+        if (packet.material && packet.material != material)
+        {
+            material = packet.material;
+            material->apply(*packet.shader);
+            frameStats.materials++;
+        }
+        if (packet.vertexArray != vertexArray)
+        {
+            vertexArray = packet.vertexArray;
+            GLState::bindVertexArray(vertexArray);
+            frameStats.vertexArrays++;
+        }
+
+        if (packet.indirectBuffer != 0)
+        {
+            if (packet.indirectBuffer != indirectBuffer)
+            {
+                indirectBuffer = packet.indirectBuffer;
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            }
+            glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(packet.indirectOffset));
+        }
+        else
+        {
+            // the base instance carries the transform; packets without one don't read it
+            const GLuint baseInstance = packet.transform >= 0 ? static_cast<GLuint>(packet.transform) : 0;
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, 0, std::max<GLsizei>(1, packet.instanceCount),
+                                                baseInstance);
+        }
+    }
+}
+
+void RenderQueue::clear()
+{
+    packets.clear();
+    transforms.clear();
+    uploadedTransforms = 0;
+    items.clear();
+    frameStats = {};
+}
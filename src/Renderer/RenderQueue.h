@@ -0,0 +1,90 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Object/Material.h"
+#include "Object/Shader.h"
+
+#include <cstdint>
+#include <vector>
+
+// Draws collected for a frame as compact packets, each with a 64-bit sort key, and submitted in key order:
+//
+//   63..60 pass | 59..48 program | 47..32 material | 31..16 vertex array | 15..0 view depth
+//
+// so every program, material and VAO is set once per run of equal keys instead of once per draw, and within
+// a state run draws go front to back. The model matrices of the frame's packets are uploaded together into
+// the StreamBuffer and bound to the Transforms block at TransformBinding; a direct draw passes the index of
+// its matrix as its base instance, and the vertex shader reads transforms[gl_BaseInstance] instead of a
+// uniform set per packet.
+class RenderQueue
+{
+public:
+    enum Pass : uint8_t
+    {
+        ScenePass = 1
+    };
+
+    // must match the Transforms block in object.vert, reflection.vert and lightbox.vert
+    static constexpr GLuint TransformBinding = 12;
+
+    struct Stats
+    {
+        uint32_t packets;
+        uint32_t programs;
+        uint32_t materials;
+        uint32_t vertexArrays;
+    };
+
+    // material may be null (the packet binds none), model may be null (the shader positions the geometry
+    // itself, e.g. instanced or pre-transformed); depth is the view-space distance used for ordering
+    void submit(uint8_t pass, Shader& shader, const Material* material, GLuint vertexArray, GLsizei indexCount,
+                GLsizei instanceCount, const glm::mat4* model, float depth);
+
+    // a glDrawElementsIndirect whose command sits at offset in indirectBuffer (e.g. filled by InstanceCuller);
+    // any storage buffers the shader needs for it have to be bound before execute()
+    void submitIndirect(uint8_t pass, Shader& shader, const Material* material, GLuint vertexArray,
+                        GLuint indirectBuffer, GLintptr offset, float depth);
+
+    // radix sorts the packets by key
+    void sort();
+
+    // issues the packets of one pass, touching state only where it differs from the previous packet
+    void execute(uint8_t pass);
+
+    // drops all packets, call once per frame before submitting
+    void clear();
+
+    const Stats& stats() const { return frameStats; }
+
+private:
+    struct Packet
+    {
+        Shader* shader;
+        const Material* material;
+        GLuint vertexArray;
+        GLsizei indexCount;
+        GLsizei instanceCount;
+        int32_t transform; // index into transforms, -1 for none
+        GLuint indirectBuffer; // 0 for a direct draw
+        GLintptr indirectOffset;
+    };
+
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    std::vector<Packet> packets;
+    std::vector<glm::mat4> transforms;
+    // where execute() put transforms in the stream buffer, and how many of them
+    GLuint transformBuffer = 0;
+    GLintptr transformOffset = 0;
+    size_t uploadedTransforms = 0;
+    std::vector<SortItem> items, scratch;
+    Stats frameStats = {};
+};
+#endif
@@ -0,0 +1,183 @@
+#include "RenderTargetPool.h"
+#include "GLState.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+    struct Target
+    {
+        RenderTargetPool::Desc desc;
+        bool inUse;
+    };
+
+    std::map<GLuint, Target> targets;
+    std::map<std::vector<GLuint>, GLuint> framebuffers; // color attachments..., depth attachment -> framebuffer
+    size_t created = 0;
+    GLsizei screenWidth = 0, screenHeight = 0;
+
+    bool sameDesc(const RenderTargetPool::Desc& a, const RenderTargetPool::Desc& b)
+    {
+        return std::tie(a.width, a.height, a.format, a.usage, a.levels) == std::tie(b.width, b.height, b.format, b.usage, b.levels);
+    }
+
+    size_t bytesPerTexel(GLenum format)
+    {
+        switch (format)
+        {
+        case GL_RGBA32F:            return 16;
+        case GL_RGBA16F:
+        case GL_RGBA16:             return 8;
+        case GL_RG16F:
+        case GL_R32F:
+        case GL_RGBA8:
+        case GL_R11F_G11F_B10F:
+        case GL_DEPTH_COMPONENT24:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8:   return 4;
+        case GL_R16F:               return 2;
+        case GL_R8:                 return 1;
+        default:                    return 4;
+        }
+    }
+
+    GLuint createTarget(const RenderTargetPool::Desc& desc)
+    {
+        GLuint texture;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, desc.levels, desc.format, desc.width, desc.height);
+        const GLint filter = desc.usage == RenderTargetPool::ColorAttachment ? GL_LINEAR : GL_NEAREST;
+        const GLint minFilter = desc.levels > 1 ? (filter == GL_LINEAR ? GL_LINEAR_MIPMAP_NEAREST : GL_NEAREST_MIPMAP_NEAREST) : filter;
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, filter);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        created++;
+        spdlog::debug("[RenderTargetPool] created target {}: {}x{}, format 0x{:x}, {} levels", texture, desc.width, desc.height,
+                      desc.format, desc.levels);
+        return texture;
+    }
+
+    void destroyTarget(GLuint target)
+    {
+        for (auto it = framebuffers.begin(); it != framebuffers.end();)
+        {
+            if (std::find(it->first.begin(), it->first.end(), target) != it->first.end())
+            {
+                GLState::deleteFramebuffers(1, &it->second);
+                it = framebuffers.erase(it);
+            }
+            else
+                ++it;
+        }
+        GLState::deleteTextures(1, &target);
+        targets.erase(target);
+    }
+}
+
+GLuint RenderTargetPool::acquire(const Desc& desc)
+{
+    for (auto& [texture, target] : targets)
+    {
+        if (!target.inUse && sameDesc(target.desc, desc))
+        {
+            target.inUse = true;
+            return texture;
+        }
+    }
+
+    const GLuint texture = createTarget(desc);
+    targets[texture] = { desc, true };
+    return texture;
+}
+
+void RenderTargetPool::release(GLuint target)
+{
+    auto it = targets.find(target);
+    if (it != targets.end())
+        it->second.inUse = false;
+}
+
+GLuint RenderTargetPool::framebuffer(std::initializer_list<GLuint> colorTargets, GLuint depthTarget)
+{
+    return framebuffer(std::vector<GLuint>(colorTargets), depthTarget);
+}
+
+GLuint RenderTargetPool::framebuffer(const std::vector<GLuint>& colorTargets, GLuint depthTarget)
+{
+    std::vector<GLuint> key(colorTargets);
+    key.push_back(depthTarget);
+    auto it = framebuffers.find(key);
+    if (it != framebuffers.end())
+        return it->second;
+
+    GLuint fbo;
+    glCreateFramebuffers(1, &fbo);
+    std::vector<GLenum> drawBuffers;
+    for (GLuint target : colorTargets)
+    {
+        const GLenum attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+        glNamedFramebufferTexture(fbo, attachment, target, 0);
+        drawBuffers.push_back(attachment);
+    }
+    if (drawBuffers.empty())
+        glNamedFramebufferDrawBuffer(fbo, GL_NONE);
+    else
+        glNamedFramebufferDrawBuffers(fbo, static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+    if (depthTarget)
+        glNamedFramebufferTexture(fbo, GL_DEPTH_ATTACHMENT, depthTarget, 0);
+
+    if (glCheckNamedFramebufferStatus(fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        spdlog::error("[RenderTargetPool] framebuffer {} is not complete", fbo);
+
+    framebuffers[key] = fbo;
+    return fbo;
+}
+
+void RenderTargetPool::resize(GLsizei width, GLsizei height)
+{
+    if (width == screenWidth && height == screenHeight)
+        return;
+    screenWidth = width;
+    screenHeight = height;
+
+    // most targets follow the framebuffer size (or a fraction of it); the rest are cheap to recreate once
+    std::vector<GLuint> stale;
+    for (const auto& [texture, target] : targets)
+    {
+        if (target.inUse)
+            spdlog::warn("[RenderTargetPool] target {} still in use while resizing, keeping it", texture);
+        else
+            stale.push_back(texture);
+    }
+    for (GLuint texture : stale)
+        destroyTarget(texture);
+    spdlog::info("[RenderTargetPool] resized to {}x{}, released {} targets", width, height, stale.size());
+}
+
+size_t RenderTargetPool::targetCount()
+{
+    return targets.size();
+}
+
+size_t RenderTargetPool::allocatedBytes()
+{
+    size_t bytes = 0;
+    for (const auto& [texture, target] : targets)
+    {
+        size_t levelBytes = static_cast<size_t>(target.desc.width) * target.desc.height * bytesPerTexel(target.desc.format);
+        for (GLsizei level = 0; level < target.desc.levels; level++, levelBytes /= 4)
+            bytes += levelBytes;
+    }
+    return bytes;
+}
+
+size_t RenderTargetPool::createdCount()
+{
+    return created;
+}
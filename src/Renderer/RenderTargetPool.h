@@ -0,0 +1,51 @@
+#ifndef RENDER_TARGET_POOL_H
+#define RENDER_TARGET_POOL_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+// Render targets (immutable 2D textures) and the framebuffers built on them, kept alive across frames.
+// A pass acquires the targets it needs and releases them once nothing later in the frame reads them;
+// a released target goes back to the pool, so a later pass asking for the same description aliases its
+// memory instead of allocating. Nothing is freed until the framebuffer is resized.
+class RenderTargetPool
+{
+public:
+    // sampling and access differ per usage, so targets are only shared within one
+    enum Usage
+    {
+        ColorAttachment, // linear filtering, clamped
+        DepthAttachment, // nearest filtering, clamped
+        Storage          // image load/store from compute, nearest filtering
+    };
+
+    struct Desc
+    {
+        GLsizei width;
+        GLsizei height;
+        GLenum  format;
+        Usage   usage  = ColorAttachment;
+        GLsizei levels = 1;
+    };
+
+    // a free target matching desc, created if there is none
+    static GLuint acquire(const Desc& desc);
+    static void release(GLuint target);
+
+    // a framebuffer with the given color attachments (in draw buffer order) and optional depth attachment;
+    // created on first use and kept until one of its targets is freed
+    static GLuint framebuffer(std::initializer_list<GLuint> colorTargets, GLuint depthTarget = 0);
+    static GLuint framebuffer(const std::vector<GLuint>& colorTargets, GLuint depthTarget = 0);
+
+    // frees every released target and its framebuffers, they are recreated on the next acquire;
+    // call between frames when the default framebuffer changes size
+    static void resize(GLsizei width, GLsizei height);
+
+    static size_t targetCount();
+    static size_t allocatedBytes();
+    static size_t createdCount(); // targets created since startup, stays flat while nothing is resized
+};
+#endif
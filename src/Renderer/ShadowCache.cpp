@@ -0,0 +1,102 @@
+#include "ShadowCache.h"
+#include "GLState.h"
+
+#include <algorithm>
+
+void ShadowCache::init(GLenum textureTarget, GLuint texture, GLuint fbo, GLsizei mapSize, GLsizei mapLayers)
+{
+    target = textureTarget;
+    shadowMap = texture;
+    framebuffer = fbo;
+    size = mapSize;
+    layers = textureTarget == GL_TEXTURE_CUBE_MAP ? 6 : mapLayers;
+    layerLight.assign(layers, {});
+    dirtyLayers = allLayers();
+}
+
+void ShadowCache::setLight(const float* parameters, size_t count)
+{
+    if (light.size() == count && std::equal(light.begin(), light.end(), parameters))
+        return;
+    light.assign(parameters, parameters + count);
+    dirtyLayers = allLayers();
+}
+
+void ShadowCache::setLayerLight(GLsizei layer, const float* parameters, size_t count)
+{
+    std::vector<float>& current = layerLight[layer];
+    if (current.size() == count && std::equal(current.begin(), current.end(), parameters))
+        return;
+    current.assign(parameters, parameters + count);
+    dirtyLayers |= 1u << layer;
+}
+
+void ShadowCache::invalidate()
+{
+    dirtyLayers = allLayers();
+}
+
+void ShadowCache::render(const std::function<void()>& drawStatic, const std::function<void()>& drawDynamic)
+{
+    const bool dynamic = static_cast<bool>(drawDynamic);
+    if (dynamic && staticMap == 0)
+    {
+        glCreateTextures(target, 1, &staticMap);
+        if (target == GL_TEXTURE_2D_ARRAY)
+            glTextureStorage3D(staticMap, 1, GL_DEPTH_COMPONENT24, size, size, layers);
+        else
+            glTextureStorage2D(staticMap, 1, GL_DEPTH_COMPONENT24, size, size);
+        glCreateFramebuffers(1, &staticFramebuffer);
+        glNamedFramebufferTexture(staticFramebuffer, GL_DEPTH_ATTACHMENT, staticMap, 0);
+        glNamedFramebufferDrawBuffer(staticFramebuffer, GL_NONE);
+        glNamedFramebufferReadBuffer(staticFramebuffer, GL_NONE);
+        dirtyLayers = allLayers();
+    }
+
+    // once dynamic casters showed up the static depth is kept aside, until then it is the shadow map itself
+    const bool separate = staticMap != 0;
+    const bool redraw = dirtyLayers != 0;
+    GLState::viewport(0, 0, size, size);
+    if (redraw)
+    {
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, separate ? staticFramebuffer : framebuffer);
+        if (dirtyLayers == allLayers())
+        {
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+        else
+        {
+            // a layered attachment clears as a whole, the stale layers are cleared through the texture
+            const float farDepth = 1.0f;
+            for (GLsizei layer = 0; layer < layers; layer++)
+            {
+                if (stale(layer))
+                    glClearTexSubImage(separate ? staticMap : shadowMap, 0, 0, 0, layer, size, size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+            }
+        }
+        drawStatic();
+        for (GLsizei layer = 0; layer < layers; layer++)
+            counters.layerRenders += stale(layer);
+        dirtyLayers = 0;
+        counters.staticRenders++;
+    }
+    else
+    {
+        counters.cachedFrames++;
+    }
+
+    // restore the static depth under this frame's dynamic casters, or once the last of them is gone
+    if (separate && (redraw || dynamic || shadowMapHasDynamic))
+        copyStaticToShadowMap();
+    if (dynamic)
+    {
+        GLState::bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        drawDynamic();
+    }
+    shadowMapHasDynamic = dynamic;
+}
+
+void ShadowCache::copyStaticToShadowMap()
+{
+    glCopyImageSubData(staticMap, target, 0, 0, 0, 0, shadowMap, target, 0, 0, 0, 0, size, size, layers);
+}
@@ -0,0 +1,60 @@
+#ifndef SHADOW_CACHE_H
+#define SHADOW_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Keeps a shadow map's static casters from being rendered every frame. The static content is redrawn only
+// when the light's parameters change or invalidate() is called (static geometry moved); otherwise the map
+// is left as it is. The parameters can also be given per layer (e.g. a cascade's matrix), then only the
+// layers whose parameters changed are redrawn. Dynamic casters are drawn every frame on top of a copy of
+// the cached static depth, which lives in a second texture created the first time there are any.
+class ShadowCache
+{
+public:
+    struct Stats
+    {
+        uint32_t staticRenders; // since init
+        uint32_t layerRenders;  // layers redrawn by them
+        uint32_t cachedFrames;  // frames that reused the static depth
+    };
+
+    // shadowMap is what the scene samples (GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY of layers or GL_TEXTURE_CUBE_MAP,
+    // size x size depth texels) and framebuffer has it as its depth attachment
+    void init(GLenum target, GLuint shadowMap, GLuint framebuffer, GLsizei size, GLsizei layers = 1);
+
+    // what the static depth depends on, e.g. the light matrix; a different value invalidates it
+    void setLight(const float* parameters, size_t count);
+    // the same for one layer, a different value invalidates that layer alone
+    void setLayerLight(GLsizei layer, const float* parameters, size_t count);
+    void invalidate();
+    bool stale() const { return dirtyLayers != 0; }
+    bool stale(GLsizei layer) const { return (dirtyLayers >> layer) & 1u; }
+    // bit i set for every layer the next render() redraws
+    uint32_t staleLayers() const { return dirtyLayers; }
+
+    // redraws the static casters of the stale layers, then the dynamic ones (if any) over the static depth.
+    // drawStatic must only draw into staleLayers(), the others keep their depth. The draw callbacks find
+    // the right framebuffer bound, the layers they draw to cleared and the viewport set
+    void render(const std::function<void()>& drawStatic, const std::function<void()>& drawDynamic = nullptr);
+
+    const Stats& stats() const { return counters; }
+
+private:
+    GLenum target = GL_TEXTURE_2D;
+    GLuint shadowMap = 0, framebuffer = 0;
+    GLsizei size = 0, layers = 1;
+    GLuint staticMap = 0, staticFramebuffer = 0; // only with dynamic casters
+    std::vector<float> light;
+    std::vector<std::vector<float>> layerLight;
+    uint32_t dirtyLayers = ~0u; // at most 32 layers
+    bool shadowMapHasDynamic = false;
+    Stats counters = {};
+
+    uint32_t allLayers() const { return layers >= 32 ? ~0u : (1u << layers) - 1u; }
+    void copyStaticToShadowMap();
+};
+#endif
@@ -0,0 +1,146 @@
+#include "StaticBatch.h"
+#include "GLState.h"
+#include "GeometryArena.h"
+#include "StreamBuffer.h"
+
+#include <unordered_set>
+
+void StaticBatch::add(Entity& entity, bool castsShadows)
+{
+    if (entity.transform.isDirty())
+        entity.forceUpdateSelfAndChild();
+    const glm::mat4& model = entity.transform.getModelMatrix();
+
+    for (const Mesh& mesh : entity.meshes)
+    {
+        const GeometryArena::Range range = GeometryArena::add(mesh);
+        const DrawCommand command = { static_cast<GLuint>(range.indexCount), 1, range.firstIndex, range.baseVertex, 0 };
+        const DrawRecord record = { model, entity.materials[mesh.materialIndex].id, {} };
+
+        // gl_DrawID counts from the first command of the call, so casters have to come first
+        if (castsShadows)
+        {
+            commands.insert(commands.begin() + casterCount, command);
+            records.insert(records.begin() + casterCount, record);
+            drawEntities.insert(drawEntities.begin() + casterCount, &entity);
+            drawBounds.insert(drawBounds.begin() + casterCount, mesh.bounds.transformed(model));
+            casterCount++;
+        }
+        else
+        {
+            commands.push_back(command);
+            records.push_back(record);
+            drawEntities.push_back(&entity);
+            drawBounds.push_back(mesh.bounds.transformed(model));
+        }
+    }
+}
+
+void StaticBatch::build()
+{
+    if (commands.empty())
+        return;
+
+    glDeleteBuffers(1, &commandBuffer);
+    glCreateBuffers(1, &commandBuffer);
+    glNamedBufferStorage(commandBuffer, (2 * commands.size() + LayeredTargetCount * casterCount) * sizeof(DrawCommand), nullptr,
+                         GL_DYNAMIC_STORAGE_BIT);
+    glNamedBufferSubData(commandBuffer, 0, commands.size() * sizeof(DrawCommand), commands.data());
+    glNamedBufferSubData(commandBuffer, commands.size() * sizeof(DrawCommand), commands.size() * sizeof(DrawCommand), commands.data());
+    cameraCommands = commands;
+    // no layer masks yet, the first drawShadowCastersLayered() uploads them
+    for (auto& targetCommands : layeredCommands)
+    {
+        targetCommands.assign(commands.begin(), commands.begin() + casterCount);
+        for (DrawCommand& command : targetCommands)
+            command.instanceCount = ~0u;
+    }
+    visibleDraws = drawCount();
+    glDeleteBuffers(1, &recordBuffer);
+    glCreateBuffers(1, &recordBuffer);
+    glNamedBufferStorage(recordBuffer, records.size() * sizeof(DrawRecord), records.data(), 0);
+}
+
+void StaticBatch::cull(const std::vector<Entity*>& visible)
+{
+    if (commands.empty())
+        return;
+
+    const std::unordered_set<const Entity*> visibleSet(visible.begin(), visible.end());
+    bool changed = false;
+    visibleDraws = 0;
+    for (size_t i = 0; i < commands.size(); i++)
+    {
+        const GLuint instanceCount = visibleSet.count(drawEntities[i]) ? 1 : 0;
+        changed |= cameraCommands[i].instanceCount != instanceCount;
+        cameraCommands[i].instanceCount = instanceCount;
+        visibleDraws += instanceCount;
+    }
+    if (changed)
+        StreamBuffer::copyTo(commandBuffer, commands.size() * sizeof(DrawCommand), cameraCommands.data(),
+                             commands.size() * sizeof(DrawCommand));
+}
+
+void StaticBatch::draw(Shader& shader)
+{
+    // culled draws stay in the call with no instances, so gl_DrawID still finds each draw's record
+    multiDraw(shader, GeometryArena::vertexArray(), commands.size() * sizeof(DrawCommand), visibleDraws > 0 ? drawCount() : 0);
+}
+
+void StaticBatch::drawShadowCasters(Shader& shader)
+{
+    multiDraw(shader, GeometryArena::positionVertexArray(), 0, casterCount);
+}
+
+void StaticBatch::drawDepth(Shader& shader)
+{
+    multiDraw(shader, GeometryArena::positionVertexArray(), commands.size() * sizeof(DrawCommand), visibleDraws > 0 ? drawCount() : 0);
+}
+
+void StaticBatch::drawShadowCastersLayered(Shader& shader, LayeredTarget target, const Frustum* layers, int layerCount, GLuint layerMask)
+{
+    if (casterCount == 0)
+        return;
+
+    std::vector<DrawCommand>& layered = layeredCommands[target];
+    const GLintptr offset = (2 * commands.size() + target * casterCount) * sizeof(DrawCommand);
+    bool changed = false;
+    for (GLsizei i = 0; i < casterCount; i++)
+    {
+        GLuint mask = 0, instances = 0;
+        for (int layer = 0; layer < layerCount; layer++)
+        {
+            if ((layerMask >> layer) & 1u && layers[layer].intersectsBox(drawBounds[i]))
+            {
+                mask |= 1u << layer;
+                instances++;
+            }
+        }
+        changed |= layered[i].instanceCount != instances || layered[i].baseInstance != mask;
+        layered[i].instanceCount = instances;
+        layered[i].baseInstance = mask;
+    }
+    if (changed)
+        StreamBuffer::copyTo(commandBuffer, offset, layered.data(), casterCount * sizeof(DrawCommand));
+
+    multiDraw(shader, GeometryArena::positionVertexArray(), offset, casterCount);
+}
+
+void StaticBatch::multiDraw(Shader& shader, GLuint vertexArray, GLintptr offset, GLsizei count)
+{
+    if (count == 0)
+        return;
+
+    shader.use();
+    shader.setBool("useDrawRecords", true);
+    GLState::bindVertexArray(vertexArray);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, StorageBinding, recordBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset), count, 0);
+    shader.setBool("useDrawRecords", false);
+}
+
+bool StaticBatch::empty() const
+{
+    return commands.empty();
+}
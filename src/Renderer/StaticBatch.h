@@ -0,0 +1,97 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+#include "Object/AABB.h"
+#include "Object/Entity.h"
+#include "Object/Shader.h"
+
+#include <array>
+#include <vector>
+
+// Static props drawn with one glMultiDrawElementsIndirect per pass. Their meshes are suballocated from the
+// GeometryArena, and every draw has a record (model matrix, MaterialTable ID) in a storage buffer that the
+// vertex shader indexes with gl_DrawID once its useDrawRecords uniform is set. Since each draw picks its own
+// material this only works with shaders reading the table (MaterialTable::mode() != Discrete).
+//
+// Shadow casters are kept in front of the other draws, so a shadow pass is the same multi-draw cut short.
+// Depth-only passes read GeometryArena::positionVertexArray() instead of the full vertex layout.
+// The buffer holds the commands as added, for the shadow passes; a copy for the camera whose instance
+// counts cull() sets to zero for draws of entities outside the view; and a copy of the casters per layered
+// shadow map, where every draw has one instance per layer it touches (see drawShadowCastersLayered).
+class StaticBatch
+{
+public:
+    // must match the DrawRecords block in object.vert, shadowmap.vert and pointshadowmap.vert
+    static constexpr GLuint StorageBinding = 3;
+
+    // the layered shadow maps, each keeps its own copy of the caster commands
+    enum LayeredTarget
+    {
+        CascadeLayers,
+        CubeFaceLayers,
+        LayeredTargetCount
+    };
+
+    // queues every mesh of the entity with its current world transform; the entity must not move afterwards
+    void add(Entity& entity, bool castsShadows = true);
+
+    // uploads the draw commands and records
+    void build();
+
+    // draw() only draws the meshes of entities in visible
+    void cull(const std::vector<Entity*>& visible);
+
+    // the draws cull() kept, and every shadow caster
+    void draw(Shader& shader);
+    void drawShadowCasters(Shader& shader);
+
+    // the draws cull() kept, through the arena's position stream, for a depth prepass
+    void drawDepth(Shader& shader);
+
+    // the casters into a layered framebuffer in one multi-draw: each draw gets an instance per layer frustum
+    // its bounds intersect, and the bit mask of those layers as its baseInstance. The vertex shader routes
+    // instance i to the layer of the i-th set bit of gl_BaseInstance. At most 32 layers, only those in
+    // layerMask are drawn to
+    void drawShadowCastersLayered(Shader& shader, LayeredTarget target, const Frustum* layers, int layerCount, GLuint layerMask = ~0u);
+
+    bool empty() const;
+    GLsizei drawCount() const { return static_cast<GLsizei>(commands.size()); }
+    GLsizei visibleDrawCount() const { return visibleDraws; }
+
+private:
+    // layout fixed by glMultiDrawElementsIndirect
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // std430 layout of DrawRecord in the vertex shaders
+    struct DrawRecord
+    {
+        glm::mat4 model;
+        GLuint materialID;
+        GLuint padding[3];
+    };
+
+    void multiDraw(Shader& shader, GLuint vertexArray, GLintptr offset, GLsizei count);
+
+    std::vector<DrawCommand> commands;
+    std::vector<DrawRecord> records;
+    std::vector<const Entity*> drawEntities; // per command
+    std::vector<AABB> drawBounds;             // per command, world space
+    std::vector<DrawCommand> cameraCommands;
+    std::array<std::vector<DrawCommand>, LayeredTargetCount> layeredCommands; // per caster
+    GLsizei visibleDraws = 0;
+    GLsizei casterCount = 0;
+
+    GLuint commandBuffer = 0, recordBuffer = 0;
+};
+#endif
@@ -0,0 +1,104 @@
+#include "StreamBuffer.h"
+#include "FrameSync.h"
+
+#include <cstring>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr GLbitfield MapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    GLuint buffer = 0;
+    unsigned char* mapped = nullptr;
+    size_t regionSize = 4 << 20;
+    size_t regionStart = 0;
+    size_t cursor = 0;
+    int currentSlot = 0;
+    // outgrown buffers and the frames left until nothing refers to them
+    std::vector<std::pair<GLuint, int>> retired;
+
+    void create()
+    {
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, regionSize * FrameSync::MaxFramesInFlight, nullptr, MapFlags);
+        mapped = static_cast<unsigned char*>(glMapNamedBufferRange(buffer, 0, regionSize * FrameSync::MaxFramesInFlight, MapFlags));
+        regionStart = currentSlot * regionSize;
+        cursor = regionStart;
+    }
+}
+
+void StreamBuffer::beginFrame(int slot)
+{
+    currentSlot = slot;
+    if (buffer == 0)
+        create();
+    for (size_t i = 0; i < retired.size();)
+    {
+        if (--retired[i].second > 0)
+        {
+            i++;
+            continue;
+        }
+        glDeleteBuffers(1, &retired[i].first);
+        retired.erase(retired.begin() + i);
+    }
+    regionStart = slot * regionSize;
+    cursor = regionStart;
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t size, size_t alignment)
+{
+    if (buffer == 0)
+        create();
+
+    size_t offset = (cursor + alignment - 1) / alignment * alignment;
+    if (offset + size > regionStart + regionSize)
+    {
+        // regions that fit all of this frame; the new buffer is not in use on the GPU yet, every region is free
+        const size_t needed = cursor - regionStart + size + alignment;
+        do
+            regionSize *= 2;
+        while (regionSize < needed);
+        std::cout << "[StreamBuffer] frame outgrew its region, growing to " << (regionSize >> 10) << " KB per frame" << std::endl;
+        // allocations made earlier this frame stay mapped where they are, the old buffer lives until they are done
+        retired.emplace_back(buffer, FrameSync::MaxFramesInFlight + 1);
+        create();
+        offset = (cursor + alignment - 1) / alignment * alignment;
+    }
+
+    cursor = offset + size;
+    return { buffer, static_cast<GLintptr>(offset), mapped + offset };
+}
+
+StreamBuffer::Allocation StreamBuffer::upload(const void* data, size_t size, size_t alignment)
+{
+    const Allocation allocation = allocate(size, alignment);
+    std::memcpy(allocation.data, data, size);
+    return allocation;
+}
+
+void StreamBuffer::copyTo(GLuint destination, GLintptr offset, const void* data, size_t size)
+{
+    const Allocation source = upload(data, size, 4);
+    glCopyNamedBufferSubData(source.buffer, destination, source.offset, offset, size);
+}
+
+size_t StreamBuffer::storageAlignment()
+{
+    static GLint alignment = 0;
+    if (alignment == 0)
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return static_cast<size_t>(alignment);
+}
+
+size_t StreamBuffer::frameCapacity()
+{
+    return regionSize;
+}
+
+size_t StreamBuffer::usedBytes()
+{
+    return cursor - regionStart;
+}
@@ -0,0 +1,42 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// The one path for data the CPU writes every frame: a buffer mapped persistently and coherently, split into
+// a region per frame in flight (FrameSync::MaxFramesInFlight) and handed out front to back within the
+// frame's region. FrameSync's fences guarantee the GPU is done with a region when its slot comes around
+// again, so writing is a memcpy: no driver reallocation, no implicit synchronization. The data is used in
+// place, bound by offset, or copied on the GPU into the buffer that keeps it.
+//
+// A frame that outgrows its region continues in a new buffer with larger regions; the old one is deleted
+// once the frames that used it are done.
+class StreamBuffer
+{
+public:
+    struct Allocation
+    {
+        GLuint buffer;
+        GLintptr offset;
+        void* data; // mapped, write only
+    };
+
+    // at the start of the frame, with its FrameSync::slot()
+    static void beginFrame(int slot);
+
+    // size bytes of this frame's region, offset a multiple of alignment
+    static Allocation allocate(size_t size, size_t alignment = 16);
+    // a copy of data in this frame's region
+    static Allocation upload(const void* data, size_t size, size_t alignment = 16);
+    // replaces size bytes at offset of destination with data, in command order on the GPU
+    static void copyTo(GLuint destination, GLintptr offset, const void* data, size_t size);
+
+    // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, for ranges bound as storage buffers
+    static size_t storageAlignment();
+
+    static size_t frameCapacity();
+    static size_t usedBytes(); // of the current frame
+};
+#endif
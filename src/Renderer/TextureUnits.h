@@ -0,0 +1,27 @@
+#ifndef TEXTURE_UNITS_H
+#define TEXTURE_UNITS_H
+
+#include <glad/glad.h>
+
+// Every fixed texture unit the renderer binds to. Shaders that declare layout(binding = N) must agree.
+namespace TextureUnit
+{
+    constexpr GLuint MaterialMaps      = 0;  // 0-4, one per MaterialMap; also the scratch unit for one-off passes
+    constexpr GLuint PointShadow       = 5;
+    constexpr GLuint BrdfLut           = 7;
+    constexpr GLuint ParticleColor     = 8;  // low resolution particles, for their upsample
+    constexpr GLuint ParticleDepth     = 9;  // the depth they were tested against
+    constexpr GLuint SceneDepth        = 10; // full resolution depth for depth-aware filters
+    constexpr GLuint DirectionalShadow = 12;
+    constexpr GLuint Environment       = 13; // environment cubemap, sampled as irradianceMap
+    constexpr GLuint Prefilter         = 14;
+    constexpr GLuint ColorGradingLut   = 17; // 3D
+    constexpr GLuint SceneColor        = 18;
+    constexpr GLuint BloomSource       = 19; // source of the current bloom filter step, the bloom chain for the composite
+    constexpr GLuint DepthPyramid      = 20; // hierarchical Z, and the level being reduced while it is built
+    constexpr GLuint GBufferAlbedo     = 21; // albedo and ao of deferred shading
+    constexpr GLuint GBufferNormal     = 22; // normal, roughness and metallic
+    constexpr GLuint GBufferDepth      = 23;
+    constexpr GLuint MaterialPages     = 24; // 24-31, MaterialTable texture array pages
+}
+#endif
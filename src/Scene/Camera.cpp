@@ -23,6 +23,16 @@ glm::mat4 Camera::GetViewMatrix()
 	return glm::lookAt(Position, Position + Front, Up);
 }
 
+glm::mat4 Camera::GetProjectionMatrix(float aspect, float nearPlane, float farPlane)
+{
+	return glm::perspective(glm::radians(Zoom), aspect, nearPlane, farPlane);
+}
+
+Frustum Camera::GetFrustum(float aspect, float nearPlane, float farPlane)
+{
+	return Frustum::fromMatrix(GetProjectionMatrix(aspect, nearPlane, farPlane) * GetViewMatrix());
+}
+
 void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
 {
 	float velocity = MovementSpeed * deltaTime;
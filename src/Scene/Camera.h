@@ -6,6 +6,8 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <GLFW/glfw3.h>
 
+#include "Renderer/Frustum.h"
+
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
     FORWARD,
@@ -47,6 +49,12 @@ public:
 
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
     glm::mat4 GetViewMatrix();
+
+    // returns the perspective projection for the current Zoom
+    glm::mat4 GetProjectionMatrix(float aspect, float nearPlane, float farPlane);
+
+    // returns the planes of the view volume, for culling
+    Frustum GetFrustum(float aspect, float nearPlane, float farPlane);
     
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
@@ -32,6 +32,12 @@ IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyFontsTexture();
 IMGUI_IMPL_API bool     ImGui_ImplOpenGL3_CreateDeviceObjects();
 IMGUI_IMPL_API void     ImGui_ImplOpenGL3_DestroyDeviceObjects();
 
+// (Optional) Stream the vertex and index data through a buffer the application keeps mapped, instead of
+// reallocating the backend's own buffers every frame. The allocator returns a buffer, the offset of size bytes
+// in it (a multiple of alignment) and where they are mapped for writing; returning false falls back.
+typedef bool (*ImGui_ImplOpenGL3_StreamAllocator)(size_t size, size_t alignment, unsigned int* buffer, size_t* offset, void** data);
+IMGUI_IMPL_API void     ImGui_ImplOpenGL3_SetStreamAllocator(ImGui_ImplOpenGL3_StreamAllocator allocator);
+
 // Specific OpenGL ES versions
 //#define IMGUI_IMPL_OPENGL_ES2     // Auto-detected on Emscripten
 //#define IMGUI_IMPL_OPENGL_ES3     // Auto-detected on iOS/Android
@@ -10,12 +10,34 @@
 #include "Object/Entity.h"
 #include "Object/Model.h"
 #include "Object/Shader.h"
+#include "Renderer/GLState.h"
+#include "Renderer/MaterialTable.h"
+#include "Renderer/StaticBatch.h"
+#include "Renderer/RenderTargetPool.h"
+#include "Renderer/FrameGraph.h"
+#include "Renderer/TextureUnits.h"
+#include "Renderer/RenderQueue.h"
+#include "Renderer/GeometryArena.h"
+#include "Renderer/InstanceCuller.h"
+#include "Renderer/EntityBVH.h"
+#include "Renderer/DepthPyramid.h"
+#include "Renderer/ShadowCache.h"
+#include "Renderer/CascadedShadowMap.h"
+#include "Renderer/LightClusters.h"
+#include "Renderer/Bloom.h"
+#include "Renderer/PostProcess.h"
+#include "Renderer/DynamicResolution.h"
+#include "Renderer/LowResParticles.h"
+#include "Renderer/FrameLimiter.h"
+#include "Renderer/FrameSync.h"
+#include "Renderer/StreamBuffer.h"
 #include <stdio.h>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Object/Emitter.h"
 #include "Object/Particle.h"
 #include <iterator>
+#include <cstring>
 
 #define IMGUI_IMPL_OPENGL_LOADER_GLAD
 
@@ -47,6 +69,25 @@ constexpr int32_t WINDOW_HEIGHT = 1080;
 
 GLFWwindow* window = nullptr;
 
+// vsync by default; "--run-mode vsync|uncapped|<fps>" on the command line, or the ImGui panel
+FrameLimiter frameLimiter;
+// fences every frame, the CPU stays at most frameSync.framesInFlight frames ahead of the GPU
+FrameSync frameSync;
+
+// size of the default framebuffer, kept current by framebuffer_size_callback
+int32_t framebufferWidth  = WINDOW_WIDTH;
+int32_t framebufferHeight = WINDOW_HEIGHT;
+
+static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    // minimizing reports 0x0, keep the old targets until the window comes back
+    if (width == 0 || height == 0)
+        return;
+    framebufferWidth = width;
+    framebufferHeight = height;
+    RenderTargetPool::resize(width, height);
+}
+
 // Change these to lower GL version like 4.5 if GL 4.6 can't be initialized on your machine
 const     char*   glsl_version     = "#version 460";
 constexpr int32_t GL_VERSION_MAJOR = 4;
@@ -77,6 +118,9 @@ std::unique_ptr<Entity> leaves;
 
 std::unique_ptr<Entity> floorEntity;
 std::unique_ptr<Entity> grass;
+StaticBatch staticProps; // floor and props drawn with one multi-draw per pass, see sceneSetup
+FrameGraph frameGraph;
+RenderQueue renderQueue;
 
 std::unique_ptr<Shader> shader;
 std::unique_ptr<Shader> shadowMapShader;
@@ -85,31 +129,94 @@ std::unique_ptr<Shader> reflectionShader;
 std::unique_ptr<Shader> refractShader;
 std::unique_ptr<Shader> instancedShader;
 std::unique_ptr<Shader> lightboxShader;
-std::unique_ptr<Shader> blurShader;
-std::unique_ptr<Shader> blurShaderFinal;
+std::unique_ptr<Shader> gbufferShader;
+std::unique_ptr<Shader> gbufferInstancedShader;
+std::unique_ptr<Shader> deferredLightingShader;
+std::unique_ptr<Shader> depthPrepassShader;
+std::unique_ptr<Shader> cutoutPrepassShader;
 
 float childoffsetX{};
 float childoffsetY{};
 float childoffsetZ{};
 
 float parentOffsetX{};
-bool bloom = true;
+Bloom bloomChain;
+PostProcess postProcess; // bloom composite, tonemap, vignette, grading and FXAA in one pass
+LowResParticles lowResParticles;
+
+// the HDR passes render at a fraction of the framebuffer size, scaled to the GPU budget and upscaled by the
+// post pass. The screen sized targets keep the framebuffer size, the passes draw into the renderWidth x
+// renderHeight corner of them, so a new scale costs no allocation
+DynamicResolution dynamicResolution;
+int32_t renderWidth = WINDOW_WIDTH;
+int32_t renderHeight = WINDOW_HEIGHT;
+
+void updateRenderResolution()
+{
+    renderWidth = std::min(dynamicResolution.scaled(framebufferWidth), framebufferWidth);
+    renderHeight = std::min(dynamicResolution.scaled(framebufferHeight), framebufferHeight);
+}
 
+// the part of the screen sized targets the passes drew into, in texture coordinates
+glm::vec2 renderUvScale()
+{
+    return glm::vec2(renderWidth, renderHeight) / glm::max(glm::vec2(framebufferWidth, framebufferHeight), glm::vec2(1.0f));
+}
 
-int NR_POINT_LIGHTS = 1;
 
-unsigned int depthMapFBO;
+// point and spot lights for clustered shading: the shadowed point light, the camera's flashlight, and up
+// to extraLights of a pool scattered over the ground
+LightClusters lightClusters;
+std::vector<LightClusters::Light> sceneLights;
+std::vector<LightClusters::Light> extraLightPool;
+int extraLights = 0;
+
 const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-unsigned int depthMap;
+// four cascades of half the size: as many texels as the single map they replaced
+CascadedShadowMap cascadedShadows;
+float shadowDistance = 50.0f;
+const glm::vec3 towardSun = glm::vec3(-5.0f, 5.0f, 5.0f);
 
 unsigned int cubeDepthMapFBO;
 unsigned int depthCubemap;
+ShadowCache directionalShadowCache;
+ShadowCache pointShadowCache;
+// entities that move (the sphere orbiting in update()): outside the BVH and the static batch, drawn into the
+// shadow maps every frame over the cached static casters
+std::vector<Entity*> dynamicShadowCasters;
+std::vector<Entity*> visibleDynamicCasters; // of dynamicShadowCasters, in the camera's frustum this frame
+
+// the shadow passes write gl_Layer from the vertex shader where GL_ARB_shader_viewport_layer_array exists
+bool vertexLayerShadows = false;
+
+// draws the dynamic casters with a shadow shader into each of its layers (the uniform naming the layer of a
+// draw), nothing to do if there are none
+std::function<void()> dynamicCasterPass(Shader& shadowShader, const char* layerUniform, int layerCount)
+{
+    if (dynamicShadowCasters.empty())
+        return nullptr;
+    return [&shadowShader, layerUniform, layerCount]() {
+        shadowShader.setBool("useInstanceMatrix", false);
+        for (int layer = 0; layer < layerCount; layer++)
+        {
+            shadowShader.setInt(layerUniform, layer);
+            for (Entity* caster : dynamicShadowCasters)
+                caster->DrawDepth(shadowShader);
+        }
+    };
+}
 
 glm::mat4* modelMatrices;
 glm::mat4* treeModelMatrices;
 glm::mat4* leavesModelMatrices;
 unsigned int amount = 10000;
 unsigned int treeAmount = 200;
+InstanceCuller foliage; // grass, trees and leaves, frustum culled per pass on the GPU
+size_t grassInstances, treeInstances, leavesInstances;
+bool occlusionCulling = true; // two-phase hierarchical Z culling of the foliage
+DepthPyramid depthPyramid;
+EntityBVH sceneBVH; // floor, props and their parts
+std::vector<Entity*> visibleEntities; // of sceneBVH, in the camera's frustum this frame
 
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
@@ -128,19 +235,19 @@ void renderQuad()
              1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
         };
         // setup plane VAO
-        glGenVertexArrays(1, &quadVAO);
-        glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+        glCreateVertexArrays(1, &quadVAO);
+        glCreateBuffers(1, &quadVBO);
+        glNamedBufferStorage(quadVBO, sizeof(quadVertices), &quadVertices, 0);
+        glVertexArrayVertexBuffer(quadVAO, 0, quadVBO, 0, 5 * sizeof(float));
+        glEnableVertexArrayAttrib(quadVAO, 0);
+        glVertexArrayAttribFormat(quadVAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(quadVAO, 0, 0);
+        glEnableVertexArrayAttrib(quadVAO, 1);
+        glVertexArrayAttribFormat(quadVAO, 1, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float));
+        glVertexArrayAttribBinding(quadVAO, 1, 0);
     }
-    glBindVertexArray(quadVAO);
+    GLState::bindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
 }
 
 void renderInstancesInit() {
@@ -212,108 +319,22 @@ void renderTreesInstancesInit() {
 
 }
 
-void configureInstancedArray() {
-    unsigned int buffer;
-    glGenBuffers(1, &buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, buffer);
-    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-
-    // set transformation matrices as an instance vertex attribute (with divisor 1)
-    // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
-    // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
-    // -----------------------------------------------------------------------------------------------------------------------------------
-    for (unsigned int i = 0; i < grass->meshes.size(); i++)
-    {
-        unsigned int VAO = grass->meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
-    }
-}
-
-void configureTreeInstancedArray() {
-    unsigned int treeBuffer;
-    glGenBuffers(1, &treeBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, treeBuffer);
-    glBufferData(GL_ARRAY_BUFFER, treeAmount * sizeof(glm::mat4), &treeModelMatrices[0], GL_STATIC_DRAW);
-
-    // set transformation matrices as an instance vertex attribute (with divisor 1)
-    // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
-    // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
-    // -----------------------------------------------------------------------------------------------------------------------------------
-    for (unsigned int i = 0; i < tree->meshes.size(); i++)
-    {
-        unsigned int VAO = tree->meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
-    }
-
-}
-
-void configureLeavesInstancedArray() {
-    unsigned int leavesBuffer;
-    glGenBuffers(1, &leavesBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, leavesBuffer);
-    glBufferData(GL_ARRAY_BUFFER, treeAmount * sizeof(glm::mat4), &leavesModelMatrices[0], GL_STATIC_DRAW);
-
-    // set transformation matrices as an instance vertex attribute (with divisor 1)
-    // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
-    // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
-    // -----------------------------------------------------------------------------------------------------------------------------------
-    for (unsigned int i = 0; i < leaves->meshes.size(); i++)
+std::unique_ptr<Shader> particleSpawnShader;
+// small colored point lights over the grass plane, to load the light clusters
+void extraLightsInit() {
+    const int poolSize = 4096;
+    const float planeSize = 20.0f;
+    extraLightPool.reserve(poolSize);
+    for (int i = 0; i < poolSize; i++)
     {
-        unsigned int VAO = leaves->meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
+        const glm::vec3 position(((rand() % (int)(planeSize * 100)) / 100.0f) - planeSize / 2.0f,
+                                 0.2f + (rand() % 150) / 100.0f,
+                                 ((rand() % (int)(planeSize * 100)) / 100.0f) - planeSize / 2.0f);
+        const glm::vec3 color((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+        extraLightPool.push_back(LightClusters::pointLight(position, color * 0.5f, 1.0f + (rand() % 200) / 100.0f));
     }
-
 }
 
-std::unique_ptr<Shader> particleSpawnShader;
 std::unique_ptr<Shader> particleUpdateShader;
 std::unique_ptr<Shader> particleRenderShader;
 std::unique_ptr <ParticleEmitter> emitter;
@@ -330,14 +351,17 @@ void particlesInit()
 
 
 }
-void SetParticleVertexAttributesAndBindings(ParticleEmitter& e) {
-    GLuint VAO, VBO, EBO, instanceVBO;
+// the quad every particle is instanced over, made once; particle.vert reads the rest from the particle buffer
+GLuint particleQuadVAO = 0;
 
-    // Step 1: Create the Vertex Array Object (VAO)
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+void SetParticleVertexAttributesAndBindings() {
+    if (particleQuadVAO != 0)
+    {
+        GLState::bindVertexArray(particleQuadVAO);
+        return;
+    }
+    GLuint VBO, EBO;
 
-    // Step 2: Create the Quad VBO (Static Vertex Data)
     float quadVertices[] = {
         -0.5f, -0.5f,
          0.5f, -0.5f,
@@ -346,30 +370,25 @@ void SetParticleVertexAttributesAndBindings(ParticleEmitter& e) {
     };
     GLuint quadIndices[] = { 0, 1, 2, 0, 2, 3 }; // Two triangles to form the quad
 
-    // Create and bind the VBO for the quad vertices
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-
-    // Set vertex attributes for the quad (position and texture coordinates)
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0); // Position
-    glEnableVertexAttribArray(0);
-
-
-    // Create and bind the Element Buffer Object (EBO) for the quad indices
-    glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quadIndices), quadIndices, GL_STATIC_DRAW);
-
-    // Step 3: Create the Instance VBO (Dynamic Per-Particle Data)
-    glGenBuffers(1, &instanceVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, e.maxParticles * sizeof(Particle), nullptr, GL_DYNAMIC_DRAW); // Allocate space for the particle data
-
+    // Step 1: the quad's vertices and indices (static data)
+    glCreateBuffers(1, &VBO);
+    glNamedBufferStorage(VBO, sizeof(quadVertices), quadVertices, 0);
+    glCreateBuffers(1, &EBO);
+    glNamedBufferStorage(EBO, sizeof(quadIndices), quadIndices, 0);
+
+    // Step 2: the Vertex Array Object (VAO) reading them, position only
+    glCreateVertexArrays(1, &particleQuadVAO);
+    glVertexArrayVertexBuffer(particleQuadVAO, 0, VBO, 0, 2 * sizeof(float));
+    glVertexArrayElementBuffer(particleQuadVAO, EBO);
+    glEnableVertexArrayAttrib(particleQuadVAO, 0);
+    glVertexArrayAttribFormat(particleQuadVAO, 0, 2, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(particleQuadVAO, 0, 0);
+    GLState::bindVertexArray(particleQuadVAO);
 }
 void sceneSetup() {
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    MaterialTable::init(MaterialTable::Bindless);
     ballParent = std::make_unique<Entity>("res/models/TestScene/sphere/sphere.fbx");
     mirror = std::make_unique<Entity>("res/models/TestScene/mirrorFrame/mirrorFrame.fbx");
     lamp= std::make_unique<Entity>("res/models/TestScene/lamp/lamp.fbx");
@@ -378,15 +397,52 @@ void sceneSetup() {
     tree = std::make_unique<Entity>("res/models/TestScene/tree/tree.fbx");
     leaves = std::make_unique<Entity>("res/models/TestScene/leaves/leaves.fbx");
     
-    shader = std::make_unique<Shader>("res/shaders/object.vert", "res/shaders/object.frag");
-    shadowMapShader = std::make_unique<Shader>("res/shaders/shadowmap.vert", "res/shaders/shadowmap.frag");
-    pointShadowMapShader = std::make_unique<Shader>("res/shaders/pointshadowmap.vert", "res/shaders/pointshadowmap.frag", "res/shaders/pointshadowmap.geom");
+    // the material table mode is baked into the PBR shaders as a specialization constant
+    const std::vector<SpecializationConstant> objectConstants = MaterialTable::shaderConstants();
+
+    shader = std::make_unique<Shader>("res/shaders/object.vert", "res/shaders/object.frag", nullptr, nullptr, objectConstants);
+    // the shadow passes pick each vertex's layer in the vertex shader; without the extension a pass-through
+    // geometry shader sets the layer the vertex shader chose
+    vertexLayerShadows = glfwExtensionSupported("GL_ARB_shader_viewport_layer_array");
+    if (vertexLayerShadows)
+    {
+        const std::vector<SpecializationConstant> vertexLayer = { { 3, 1, "VERTEX_LAYER" } };
+        shadowMapShader = std::make_unique<Shader>("res/shaders/shadowmap.vert", "res/shaders/shadowmap.frag", nullptr, nullptr, vertexLayer);
+        pointShadowMapShader = std::make_unique<Shader>("res/shaders/pointshadowmap.vert", "res/shaders/pointshadowmap.frag", nullptr, nullptr, vertexLayer);
+    }
+    else
+    {
+        shadowMapShader = std::make_unique<Shader>("res/shaders/shadowmap.vert", "res/shaders/shadowmap.frag", "res/shaders/shadowmap.geom");
+        pointShadowMapShader = std::make_unique<Shader>("res/shaders/pointshadowmap.vert", "res/shaders/pointshadowmap.frag", "res/shaders/pointshadowmap.geom");
+    }
     reflectionShader = std::make_unique<Shader>("res/shaders/reflection.vert", "res/shaders/reflection.frag");
     refractShader = std::make_unique<Shader>("res/shaders/reflection.vert", "res/shaders/refract.frag");
-    instancedShader = std::make_unique<Shader>("res/shaders/objectInstanced.vert", "res/shaders/object.frag");
+    instancedShader = std::make_unique<Shader>("res/shaders/objectInstanced.vert", "res/shaders/object.frag", nullptr, nullptr, objectConstants);
     lightboxShader = std::make_unique<Shader>("res/shaders/lightbox.vert", "res/shaders/lightbox.frag");
-    blurShader = std::make_unique<Shader>("res/shaders/blur.vert", "res/shaders/blur.frag");
-    blurShaderFinal = std::make_unique<Shader>("res/shaders/blurShaderFinal.vert", "res/shaders/blurShaderFinal.frag");
+
+    // deferred shading runs object.frag too: writing the G-buffer behind both geometry vertex shaders, and
+    // shading it under a full-screen quad
+    std::vector<SpecializationConstant> gbufferConstants = objectConstants;
+    gbufferConstants.push_back({ 3, 1, "DEFERRED" });
+    std::vector<SpecializationConstant> deferredLightingConstants = objectConstants;
+    deferredLightingConstants.push_back({ 3, 2, "DEFERRED" });
+    gbufferShader = std::make_unique<Shader>("res/shaders/object.vert", "res/shaders/object.frag", nullptr, nullptr, gbufferConstants);
+    gbufferInstancedShader = std::make_unique<Shader>("res/shaders/objectInstanced.vert", "res/shaders/object.frag", nullptr, nullptr, gbufferConstants);
+    deferredLightingShader = std::make_unique<Shader>("res/shaders/deferred.vert", "res/shaders/object.frag", nullptr, nullptr, deferredLightingConstants);
+
+    // depth prepass: the position stream with no fragment work, and for alpha tested foliage object.frag
+    // cut short after its alpha test
+    std::vector<SpecializationConstant> cutoutConstants = objectConstants;
+    cutoutConstants.push_back({ 4, 1, "DEPTH_ONLY" });
+    depthPrepassShader = std::make_unique<Shader>("res/shaders/depthprepass.vert", "res/shaders/shadowmap.frag");
+    cutoutPrepassShader = std::make_unique<Shader>("res/shaders/objectInstanced.vert", "res/shaders/object.frag", nullptr, nullptr, cutoutConstants);
+
+    // material samplers live on fixed units, resolve them once per program
+    Material::assignSamplerUnits(*shader);
+    Material::assignSamplerUnits(*instancedShader);
+    Material::assignSamplerUnits(*gbufferShader);
+    Material::assignSamplerUnits(*gbufferInstancedShader);
+    Material::assignSamplerUnits(*cutoutPrepassShader);
 
     ballParent->transform.setLocalPosition(glm::vec3(0, 0.8, 0));
     ballParent->transform.setLocalScale(glm::vec3(0.1, 0.1, 0.1));
@@ -412,6 +468,7 @@ void sceneSetup() {
     ballParent->children.front()->transform.setLocalScale(glm::vec3(1,1,1));
 
     ballParent->updateSelfAndChild();
+    dynamicShadowCasters.push_back(ballParent->children.front().get());
 
     floorEntity->transform.setLocalScale(glm::vec3(10.0, 10.0, 10.0));
     floorEntity->transform.setLocalPosition(glm::vec3(0, 0, 0));
@@ -436,6 +493,25 @@ void sceneSetup() {
 
     floorEntity->updateSelfAndChild();
 
+    // the floor and the props standing on it never move; with a material table they go out in one multi-draw
+    // per pass (the floor itself casts no shadow)
+    if (MaterialTable::mixedMaterialDraws())
+    {
+        staticProps.add(*floorEntity, false);
+        for (auto& child : floorEntity->children)
+            staticProps.add(*child);
+        staticProps.build();
+    }
+
+    std::vector<Entity*> sceneEntities = { floorEntity.get() };
+    for (auto& child : floorEntity->children)
+    {
+        sceneEntities.push_back(child.get());
+        for (auto& part : child->children)
+            sceneEntities.push_back(part.get());
+    }
+    sceneBVH.build(sceneEntities);
+
     grass->transform.setLocalScale({ 0.1,0.2,0.1 });
     grass->updateSelfAndChild();
 
@@ -446,58 +522,40 @@ void sceneSetup() {
 
    renderInstancesInit();
    renderTreesInstancesInit();
-   configureInstancedArray();
-   configureTreeInstancedArray();
-   configureLeavesInstancedArray();
+   grassInstances = foliage.add(*grass, modelMatrices, amount);
+   treeInstances = foliage.add(*tree, treeModelMatrices, treeAmount);
+   leavesInstances = foliage.add(*leaves, leavesModelMatrices, treeAmount);
+   foliage.build();
    particlesInit();
+   extraLightsInit();
 
 
 }
 
 void shadowMapFramebufferInit() {
-    glGenFramebuffers(1, &depthMapFBO);
-
-
-    glGenTextures(1, &depthMap);
-    glActiveTexture(GL_TEXTURE12);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-        SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    cascadedShadows.init(SHADOW_WIDTH / 2);
+    GLState::bindTexture(TextureUnit::DirectionalShadow, cascadedShadows.texture());
+    directionalShadowCache.init(GL_TEXTURE_2D_ARRAY, cascadedShadows.texture(), cascadedShadows.framebuffer(),
+                                cascadedShadows.size(), CascadedShadowMap::CascadeCount);
 }
 
 void pointShadowMapInit() {
-    glGenFramebuffers(1, &cubeDepthMapFBO);
-
-    glGenTextures(1, &depthCubemap);
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-    for (unsigned int i = 0; i < 6; ++i)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
-            SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, cubeDepthMapFBO);
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glCreateFramebuffers(1, &cubeDepthMapFBO);
+
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &depthCubemap);
+    glTextureStorage2D(depthCubemap, 1, GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT);
+
+    glTextureParameteri(depthCubemap, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(depthCubemap, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(depthCubemap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(depthCubemap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(depthCubemap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    GLState::bindTexture(TextureUnit::PointShadow, depthCubemap);
+
+    glNamedFramebufferTexture(cubeDepthMapFBO, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
+    glNamedFramebufferDrawBuffer(cubeDepthMapFBO, GL_NONE);
+    glNamedFramebufferReadBuffer(cubeDepthMapFBO, GL_NONE);
+    pointShadowCache.init(GL_TEXTURE_CUBE_MAP, depthCubemap, cubeDepthMapFBO, SHADOW_WIDTH);
 
 }
 
@@ -505,10 +563,8 @@ void pointShadowMapInit() {
 
 
 
-void updateAndRenderParticles()
+void spawnParticles()
 {
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
     // particle spawn loop- one dispatch per emitter
     particleSpawnShader->use();
     emitter->timer += deltaTime;
@@ -533,10 +589,10 @@ void updateAndRenderParticles()
         int numWorkGroups = (particlesToSpawn + workGroupSize - 1) / workGroupSize;
         glDispatchCompute(numWorkGroups, 1, 1);
         }
+}
 
-    // ensure that the spawned particles are visible in particle updates
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
+void updateParticles()
+{
     // particle update loop- again, one dispatch per emitter
     particleUpdateShader->use();
     particleUpdateShader->setFloat("u_dt", deltaTime);
@@ -545,16 +601,18 @@ void updateAndRenderParticles()
     int workGroupSize = 128;
         int numWorkGroups = (emitter->maxParticles + workGroupSize - 1) / workGroupSize;
         glDispatchCompute(numWorkGroups, 1, 1);
+}
 
-        SetParticleVertexAttributesAndBindings(*emitter.get());
+void renderParticles()
+{
+        SetParticleVertexAttributesAndBindings();
         particleRenderShader->use();
         auto v = camera.GetViewMatrix();
-        particleRenderShader->setMat4("u_viewProj", glm::perspective(glm::radians(camera.Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f) * camera.GetViewMatrix());
+        particleRenderShader->setMat4("u_viewProj", glm::perspective(glm::radians(camera.Zoom), (float)framebufferWidth / (float)framebufferHeight, 0.1f, 100.0f) * camera.GetViewMatrix());
         particleRenderShader->setVec3("u_cameraRight", camera.Right);
         particleRenderShader->setVec3("u_cameraUp", { camera.Up});
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D,emitter->sprite);
+        GLState::bindTexture(TextureUnit::MaterialMaps, emitter->sprite);
         glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, emitter->maxParticles);
        // glBufferSubData( emitter.get()->particlesBuffer
 
@@ -563,8 +621,12 @@ void updateAndRenderParticles()
 }
 
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
+    for (int i = 1; i + 1 < argc; i++)
+        if (std::strcmp(argv[i], "--run-mode") == 0 && !frameLimiter.parse(argv[++i]))
+            spdlog::warn("Unknown run mode {}, expected vsync, uncapped or a frame rate", argv[i]);
+
     if (!init())
     {
         spdlog::error("Failed to initialize project!");
@@ -578,6 +640,10 @@ int main(int, char**)
     // Main loop
     while (!glfwWindowShouldClose(window))
     {
+        // Wait for the GPU before sampling input, so the input is no older than the frames in flight
+        frameSync.beginFrame();
+        StreamBuffer::beginFrame(frameSync.slot());
+
         // Process I/O operations here
         input();
 
@@ -594,6 +660,7 @@ int main(int, char**)
 
         // End frame and swap buffers (double buffering)
         end_frame();
+        frameSync.endFrame();
     }
 
     // Cleanup
@@ -612,8 +679,8 @@ void GLAPIENTRY OpenGLDebugCallback(GLenum source, GLenum type, GLuint id, GLenu
 }
 
 void EnableOpenGLDebug() {
-    glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    GLState::enable(GL_DEBUG_OUTPUT);
+    GLState::enable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
     glDebugMessageCallback(OpenGLDebugCallback, nullptr);
 }
 
@@ -642,7 +709,7 @@ bool init()
     }
 
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1); // Enable VSync - fixes FPS at the refresh rate of your screen
+    frameLimiter.setMode(frameLimiter.mode()); // the swap interval of the run mode
 
     bool err = !gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
 
@@ -669,6 +736,10 @@ bool init()
 
 
     glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    RenderTargetPool::resize(framebufferWidth, framebufferHeight);
+    updateRenderResolution();
 
 
     sceneSetup();
@@ -690,6 +761,14 @@ void init_imgui()
 
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    // the UI's vertices and indices go through the stream buffer like everything else written per frame
+    ImGui_ImplOpenGL3_SetStreamAllocator([](size_t size, size_t alignment, unsigned int* buffer, size_t* offset, void** data) {
+        const StreamBuffer::Allocation allocation = StreamBuffer::allocate(size, alignment);
+        *buffer = allocation.buffer;
+        *offset = static_cast<size_t>(allocation.offset);
+        *data = allocation.data;
+        return true;
+    });
 
     // Setup style
     ImGui::StyleColorsDark();
@@ -751,6 +830,7 @@ void update()
 
         // Set the child's local position (rotation in the XZ plane around the parent)
         ballParent->children.front()->transform.setLocalPosition(glm::vec3(childX, 0, childZ));
+        ballParent->updateSelfAndChild();
     
 
     // Update game objects' state here
@@ -759,398 +839,316 @@ void update()
 
 glm::vec3 dirLightColor{ 1,1,1 };
 
-void renderScene()
-{
-    //bloom setup
-    unsigned int hdrFBO;
-    glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        if (i == 0)
-            glActiveTexture(GL_TEXTURE18);
-        else glActiveTexture(GL_TEXTURE19);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(
-            GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL
-        );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(
-            GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0
-        );
-    }
-
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-
-    // Create and attach depth renderbuffer
-    unsigned int depthRenderbuffer;
-    glGenRenderbuffers(1, &depthRenderbuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WINDOW_WIDTH, WINDOW_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
-
+// forward shading, or deferred: a geometry pass filling a compact G-buffer and one lighting pass over its
+// pixels, see object.frag's DEFERRED; switched between frames
+bool deferredShading = false;
 
-    //rest of the scene
+// fills the scene depth before shading, which then only passes GL_EQUAL: object.frag runs once per pixel
+// however much foliage overlaps
+bool depthPrepass = true;
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    skybox->showSkybox(camera, WINDOW_WIDTH, WINDOW_HEIGHT);
+// after the prepass the depth is final; the shading passes neither write it nor draw what it hides
+void prepassedDepthTest(bool prepassed)
+{
+    GLState::depthFunc(prepassed ? GL_EQUAL : GL_LESS);
+    GLState::depthMask(!prepassed);
+}
 
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+void applyCamera(Shader& cameraShader)
+{
+    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)framebufferWidth / (float)framebufferHeight, 0.1f, 100.0f);
     glm::mat4 view = camera.GetViewMatrix();
+    cameraShader.setMat4("projection", projection);
+    cameraShader.setMat4("view", view);
+    cameraShader.setMat4("inverseViewProjection", glm::inverse(projection * view));
+    cameraShader.setVec2("renderSize", glm::vec2(renderWidth, renderHeight));
+}
 
+// everything object.frag shades with; pointShadowFar is the far plane of the point light's cube map
+void applySceneLighting(Shader& pbrShader, float pointShadowFar)
+{
+    applyCamera(pbrShader);
+
+    pbrShader.setVec3("dirLight.direction", { -1.0f, -1.0f, 1.0f });
+    pbrShader.setVec3("dirLight.ambient", { 1.2f, 1.0f, 1.2f });
+    pbrShader.setVec3("dirLight.diffuse",  dirLightColor);
+    pbrShader.setVec3("dirLight.specular", { 0.5f, 0.5f, 0.5f });
+    pbrShader.setVec3("viewPos", camera.Position);
+
+    pbrShader.setFloat("material.shininess", 16.0f);
+    pbrShader.setInt("irradianceMap", TextureUnit::Environment);
+    pbrShader.setInt("prefilterMap", TextureUnit::Prefilter);
+    pbrShader.setInt("brdfLUT", TextureUnit::BrdfLut);
+    pbrShader.setInt("shadowMap", TextureUnit::DirectionalShadow);
+    pbrShader.setInt("depthMap", TextureUnit::PointShadow);
+    pbrShader.setFloat("far_plane", pointShadowFar);
+
+    cascadedShadows.apply(pbrShader);
+    lightClusters.apply(pbrShader);
+}
 
+void bindSceneLighting()
+{
+    GLState::bindTexture(TextureUnit::BrdfLut, skybox->getbrdfLUTTexture());
+    GLState::bindTexture(TextureUnit::DirectionalShadow, cascadedShadows.texture());
+    GLState::bindTexture(TextureUnit::PointShadow, depthCubemap);
+    lightClusters.bind();
+}
 
-    shader->setMat4("projection", projection);
-    shader->setMat4("view", view);
-
-    shader->setVec3("dirLight.direction", { -1.0f, -1.0f, 1.0f });
-    shader->setVec3("dirLight.ambient", { 1.2f, 1.0f, 1.2f });
-    shader->setVec3("dirLight.diffuse",  dirLightColor);
-    shader->setVec3("dirLight.specular", { 0.5f, 0.5f, 0.5f });
-    shader->setVec3("viewPos", camera.Position);
-    
-    
-
-    
-
-    std::vector<glm::vec3> pointLightPositions = {
-    glm::vec3(1.2f, 1.0f, 2.0f),
-    glm::vec3(2.3f, -3.3f, -4.0f),
-    glm::vec3(-4.0f, 2.0f, -12.0f),
-    glm::vec3(0.0f, 0.0f, -3.0f)
-    };
-
-    
-
-    for (int i = 0; i < NR_POINT_LIGHTS; i++)
-    {
-        std::string base = "pointLights[" + std::to_string(i) + "].";
-        shader->setVec3(base + "position", glm::vec3(-0.2f, 0.6f, 0));
-        shader->setVec3(base + "ambient", glm::vec3(1.0f, 1.0f, 0.6f));
-        shader->setVec3(base + "diffuse", glm::vec3(1.0f, 1.0f, 0.6f));
-        shader->setVec3(base + "specular", glm::vec3(1.0f, 1.0f, 0.6f));
-        shader->setFloat(base + "constant", 1.0f);
-        shader->setFloat(base + "linear", 0.09f);
-        shader->setFloat(base + "quadratic", 0.032f);
-        
-        
-    }
-
-    shader->setVec3("spotLight.position", camera.Position);
-    shader->setVec3("spotLight.direction", camera.Front);
-    shader->setVec3("spotLight.ambient", glm::vec3(0.0f, 0.0f, 0.2f));
-    shader->setVec3("spotLight.diffuse", glm::vec3(0.0f, 0.0f, 1.0f));
-    shader->setVec3("spotLight.specular", glm::vec3(0.5f, 0.5f, 1.0f));
-    shader->setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-    shader->setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-    shader->setFloat("spotLight.constant", 1.0f);
-    shader->setFloat("spotLight.linear", 0.09f);
-    shader->setFloat("spotLight.quadratic", 0.032f);
-    
-    
-
-
-    shader->setFloat("material.shininess", 16.0f);
-    shader->setInt("irradianceMap", 13);
-    shader->setInt("prefilterMap", 14);
-    shader->setInt("brdfLUT", 7);
-    
-
-
-    floorEntity->Draw(*shader.get());
+// the mirror glass and the lamp's glowing inside keep their own forward shaders in both paths
+Shader* forwardShaderFor(const Entity* entity)
+{
+    const Entity* mirrorGlass = floorEntity->children.front()->children.front().get();
+    auto it = floorEntity->children.begin();
+    std::advance(it, 1);
+    const Entity* lampInside = it->get()->children.front().get();
+    if (entity == mirrorGlass)
+        return reflectionShader.get();
+    if (entity == lampInside)
+        return lightboxShader.get();
+    return nullptr;
+}
 
-    for (auto& child : floorEntity->children) {
-        child->Draw(*shader.get());
-        
-    }
+// the opaque PBR geometry: the static batch, drawn right away, or the visible entities without one, and the
+// foliage the camera's cull kept, both queued
+void submitOpaque(Shader& objectShader, Shader& foliageShader)
+{
+    if (!staticProps.empty())
+        staticProps.draw(objectShader);
     /*mirror->Draw(*shader.get());
     lamp->Draw(*shader.get());*/
     /*tree->Draw(*shader.get());
     leaves->Draw(*shader.get());*/
 
-    
-    
-
-
-    lightboxShader->use();
-    lightboxShader->setMat4("projection", projection);
-    lightboxShader->setMat4("view", view);
-    lightboxShader->setVec3("lightColor", glm::vec3(5.0f, 5.0f, 5.0f));
-
-    /*ballParent->Draw(*shader.get());*/
-    /*ballParent->Draw(*reflectionShader.get());*/
-    /*ballParent->Draw(*refractShader.get());*/
-    /*ballParent->Draw(*lightboxShader.get());*/
-    
-    floorEntity->children.front()->children.front()->Draw(*reflectionShader.get());
-    auto it = floorEntity->children.begin();
-    std::advance(it, 1);
-    it->get()->children.front()->Draw(*lightboxShader.get());
-
-    instancedShader->use();
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, grass->meshes[0].textures[0].id);
-    
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, grass->meshes[0].textures[1].id);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, grass->meshes[0].textures[2].id);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, grass->meshes[0].textures[3].id);
-
-    glActiveTexture(GL_TEXTURE7);
-    glBindTexture(GL_TEXTURE_2D, skybox->getbrdfLUTTexture());
-
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, grass->meshes[0].textures[4].id);
-
-
-    instancedShader->setMat4("projection", projection);
-    instancedShader->setMat4("view", view);
-
-    instancedShader->setInt("material.albedoMap", 0);
-    instancedShader->setInt("material.aoMap", 1);
-    instancedShader->setInt("material.metallicMap", 2);
-    instancedShader->setInt("material.normalMap", 3);
-    instancedShader->setInt("material.roughnessMap", 4);
-
-    instancedShader->setFloat("material.shininess", 16.0f);
-    instancedShader->setInt("irradianceMap", 13);
-    instancedShader->setInt("prefilterMap", 14);
-    instancedShader->setInt("brdfLUT", 7);
-
-    instancedShader->setVec3("dirLight.direction", { -1.0f, -1.0f, 1.0f });
-    instancedShader->setVec3("dirLight.ambient", { 1.2f, 1.0f, 1.2f });
-    instancedShader->setVec3("dirLight.diffuse", dirLightColor);
-    instancedShader->setVec3("dirLight.specular", { 0.5f, 0.5f, 0.5f });
-    instancedShader->setVec3("viewPos", camera.Position);
-
-    std::string base = "pointLights[" + std::to_string(0) + "].";
-    instancedShader->setVec3(base + "position", glm::vec3(-0.2f, 0.6f, 0));
-    instancedShader->setVec3(base + "ambient", glm::vec3(1.0f, 1.0f, 0.6f));  // Light yellow ambient
-    instancedShader->setVec3(base + "diffuse", glm::vec3(1.0f, 1.0f, 0.6f));  // Light yellow diffuse
-    instancedShader->setVec3(base + "specular", glm::vec3(1.0f, 1.0f, 0.6f)); // Light yellow specular
-    instancedShader->setFloat(base + "constant", 1.0f);
-    instancedShader->setFloat(base + "linear", 0.09f);
-    instancedShader->setFloat(base + "quadratic", 0.032f);
-
-        instancedShader->setVec3("spotLight.position", camera.Position);
-    instancedShader->setVec3("spotLight.direction", camera.Front);
-    instancedShader->setVec3("spotLight.ambient", glm::vec3(0.0f, 0.0f, 0.2f));
-    instancedShader->setVec3("spotLight.diffuse", glm::vec3(0.0f, 0.0f, 1.0f));
-    instancedShader->setVec3("spotLight.specular", glm::vec3(0.5f, 0.5f, 1.0f));
-    instancedShader->setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-    instancedShader->setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-    instancedShader->setFloat("spotLight.constant", 1.0f);
-    instancedShader->setFloat("spotLight.linear", 0.09f);
-    instancedShader->setFloat("spotLight.quadratic", 0.032f);
-
-    glActiveTexture(GL_TEXTURE12);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    instancedShader->setInt("shadowMap", 12);
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-    instancedShader->setInt("depthMap", 5);
-
+    // only what the BVH found inside the view frustum, see render(); the static batch culled its own draws
+    for (Entity* entity : visibleEntities)
+    {
+        if (staticProps.empty() && !forwardShaderFor(entity))
+            entity->submit(renderQueue, RenderQueue::ScenePass, objectShader, camera);
+    }
+    for (Entity* entity : visibleDynamicCasters)
+        entity->submit(renderQueue, RenderQueue::ScenePass, objectShader, camera);
 
-    
     for (unsigned int i = 0; i < grass->meshes.size(); i++)
     {
-        glBindVertexArray(grass->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, grass->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, amount
-        );
+        const Mesh& mesh = grass->meshes[i];
+        renderQueue.submitIndirect(RenderQueue::ScenePass, foliageShader, &grass->materials[mesh.materialIndex], mesh.VAO,
+                                   foliage.commandBuffer(), foliage.commandOffset(grassInstances, InstanceCuller::CameraView, i), 0.0f);
     }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, tree->meshes[0].textures[0].id);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, tree->meshes[0].textures[1].id);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, tree->meshes[0].textures[2].id);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, tree->meshes[0].textures[3].id);
-
-    glActiveTexture(GL_TEXTURE7);
-    glBindTexture(GL_TEXTURE_2D, skybox->getbrdfLUTTexture());
-
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, tree->meshes[0].textures[4].id);
-
     for (unsigned int i = 0; i < tree->meshes.size(); i++)
     {
-        glBindVertexArray(tree->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, tree->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, treeAmount
-        );
+        const Mesh& mesh = tree->meshes[i];
+        renderQueue.submitIndirect(RenderQueue::ScenePass, foliageShader, &tree->materials[mesh.materialIndex], mesh.VAO,
+                                   foliage.commandBuffer(), foliage.commandOffset(treeInstances, InstanceCuller::CameraView, i), 0.0f);
     }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, leaves->meshes[0].textures[0].id);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, leaves->meshes[0].textures[1].id);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, leaves->meshes[0].textures[2].id);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, leaves->meshes[0].textures[3].id);
-
-    glActiveTexture(GL_TEXTURE7);
-    glBindTexture(GL_TEXTURE_2D, skybox->getbrdfLUTTexture());
-
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, leaves->meshes[0].textures[4].id);
-
     for (unsigned int i = 0; i < leaves->meshes.size(); i++)
     {
-        glBindVertexArray(leaves->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, leaves->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, treeAmount
-        );
+        const Mesh& mesh = leaves->meshes[i];
+        renderQueue.submitIndirect(RenderQueue::ScenePass, foliageShader, &leaves->materials[mesh.materialIndex], mesh.VAO,
+                                   foliage.commandBuffer(), foliage.commandOffset(leavesInstances, InstanceCuller::CameraView, i), 0.0f);
     }
+}
 
-    updateAndRenderParticles();
+// queues the visible entities with forward shaders of their own
+void submitForwardOnly()
+{
+    applyCamera(*reflectionShader);
+    reflectionShader->setInt("skybox", 0);
+    applyCamera(*refractShader);
+    refractShader->setInt("skybox", 0);
 
+    applyCamera(*lightboxShader);
+    lightboxShader->setVec3("lightColor", glm::vec3(5.0f, 5.0f, 5.0f));
 
+    /*ballParent->Draw(*shader.get());*/
+    /*ballParent->Draw(*reflectionShader.get());*/
+    /*ballParent->Draw(*refractShader.get());*/
+    /*ballParent->Draw(*lightboxShader.get());*/
 
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongBuffer[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongBuffer);
-    for (unsigned int i = 0; i < 2; i++)
+    for (Entity* entity : visibleEntities)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        if (i == 0)
-            glActiveTexture(GL_TEXTURE20);
-        else glActiveTexture(GL_TEXTURE21);
-        glBindTexture(GL_TEXTURE_2D, pingpongBuffer[i]);
-        glTexImage2D(
-            GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL
-        );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(
-            GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongBuffer[i], 0
-        );
+        if (Shader* forwardShader = forwardShaderFor(entity))
+            entity->submit(renderQueue, RenderQueue::ScenePass, *forwardShader, camera);
     }
+}
 
-    bool horizontal = true, first_iteration = true;
-    unsigned int amount = 10;
-    blurShader->use();
-    blurShader->setInt("image", 19);
+// depth of everything the scene pass draws into the bound depth-only framebuffer. Opaque geometry reads the
+// position stream; grass and leaves need their alpha test, so they take their full vertices and materials
+void renderDepthPrepass()
+{
+    glClear(GL_DEPTH_BUFFER_BIT);
+    applyCamera(*depthPrepassShader);
+    applyCamera(*cutoutPrepassShader);
 
-    for (unsigned int i = 0; i < amount; i++)
+    if (!staticProps.empty())
+        staticProps.drawDepth(*depthPrepassShader);
+    for (Entity* entity : visibleEntities)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-        blurShader->setInt("horizontal", horizontal);
-        glActiveTexture(GL_TEXTURE19);
-        glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongBuffer[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
-
+        if (staticProps.empty() || forwardShaderFor(entity))
+            entity->DrawDepth(*depthPrepassShader);
+    }
+    for (Entity* entity : visibleDynamicCasters)
+        entity->DrawDepth(*depthPrepassShader);
+
+    foliage.bind();
+    depthPrepassShader->use();
+    depthPrepassShader->setBool("useInstanceMatrix", true);
+    foliage.draw(treeInstances, InstanceCuller::CameraView);
+    depthPrepassShader->setBool("useInstanceMatrix", false);
+
+    cutoutPrepassShader->use();
+    foliage.draw(grassInstances, InstanceCuller::CameraView, cutoutPrepassShader.get());
+    foliage.draw(leavesInstances, InstanceCuller::CameraView, cutoutPrepassShader.get());
+}
 
-        //render quad
-        renderQuad();
-        //end of render quad
-        horizontal = !horizontal;
-        if (first_iteration)
-            first_iteration = false;
+// draws into the bound HDR framebuffer (scene color, bright color, depth)
+void renderScene()
+{
+    glClear(depthPrepass ? GL_COLOR_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    skybox->showSkybox(camera, framebufferWidth, framebufferHeight);
+    bindSceneLighting();
+
+    // draws are queued and go out sorted by program, material and VAO at the end
+    renderQueue.clear();
+    prepassedDepthTest(depthPrepass);
+    submitOpaque(*shader, *instancedShader);
+    submitForwardOnly();
+
+    foliage.bind();
+    renderQueue.sort();
+    renderQueue.execute(RenderQueue::ScenePass);
+    prepassedDepthTest(false);
+}
 
+// deferred geometry pass, draws the opaque geometry into the bound G-buffer (albedo and ao; normal, roughness
+// and metallic; depth)
+void renderGBuffer()
+{
+    glClear(depthPrepass ? GL_COLOR_BUFFER_BIT : GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    renderQueue.clear();
+    prepassedDepthTest(depthPrepass);
+    submitOpaque(*gbufferShader, *gbufferInstancedShader);
 
+    foliage.bind();
+    renderQueue.sort();
+    renderQueue.execute(RenderQueue::ScenePass);
+    prepassedDepthTest(false);
+}
 
-    blurShaderFinal->use();
-    blurShaderFinal->setInt("scene", 18);
-    blurShaderFinal->setInt("bloomBlur", 19);
-    blurShaderFinal->setFloat("exposure", 1.0f);
-    blurShaderFinal->setBool("bloom", bloom);
+// deferred lighting pass into the bound scene and bright color: the skybox, then every covered pixel shaded
+// once; there is no depth attachment, the G-buffer depth is sampled instead
+void renderDeferredLighting(GLuint albedo, GLuint normal, GLuint depth)
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+    skybox->showSkybox(camera, framebufferWidth, framebufferHeight);
+    bindSceneLighting();
+
+    GLState::bindTexture(TextureUnit::GBufferAlbedo, albedo);
+    GLState::bindTexture(TextureUnit::GBufferNormal, normal);
+    GLState::bindTexture(TextureUnit::GBufferDepth, depth);
+    deferredLightingShader->use();
     renderQuad();
+}
+
+// what deferred shading leaves to forward shading, drawn over the lit scene with its depth
+void renderForwardOnly()
+{
+    renderQueue.clear();
+    prepassedDepthTest(depthPrepass);
+    submitForwardOnly();
+    renderQueue.sort();
+    renderQueue.execute(RenderQueue::ScenePass);
+    prepassedDepthTest(false);
+}
 
-    glDeleteRenderbuffers(1, &depthRenderbuffer);
-    glDeleteTextures(2, colorBuffers);
-    glDeleteFramebuffers(1, &hdrFBO);
-    glDeleteTextures(2, pingpongBuffer);
-    glDeleteFramebuffers(2, pingpongFBO);
+void composite(GLuint sceneColor, GLuint bloomBlur)
+{
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::viewport(0, 0, framebufferWidth, framebufferHeight);
+    // the pass covers every pixel, only the depth needs clearing
+    glClear(GL_DEPTH_BUFFER_BIT);
 
+    postProcess.apply(sceneColor, bloomBlur, bloomChain.sampler(), renderUvScale());
 }
 
 
 void render() {
-    
-    //DIRECTIONAL SHADOW MAP
-    float near_plane = 1.0f, far_plane = 7.5f;
-    glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
+    GLState::resetStats();
+    dynamicResolution.beginFrame();
+    updateRenderResolution();
+    MaterialTable::bind();
+
+    const float cameraAspect = (float)framebufferWidth / (float)framebufferHeight;
+    const glm::mat4 cameraViewProjection = camera.GetProjectionMatrix(cameraAspect, 0.1f, 100.0f) * camera.GetViewMatrix();
+    const Frustum cameraFrustum = camera.GetFrustum(cameraAspect, 0.1f, 100.0f);
+
+    // CPU frustum culling of the scene entities, consumed by the scene pass
+    const bool sceneMoved = sceneBVH.refit();
+    sceneBVH.cull(cameraFrustum, visibleEntities);
+    staticProps.cull(visibleEntities);
+    visibleDynamicCasters.clear();
+    for (Entity* caster : dynamicShadowCasters)
+    {
+        const AABB bounds = caster->worldBounds();
+        if (bounds.empty() || cameraFrustum.intersectsBox(bounds))
+            visibleDynamicCasters.push_back(caster);
+    }
 
-    glm::mat4 lightView = glm::lookAt(glm::vec3(-5.0f, 5.0f, 5.0f),
-        glm::vec3(0.0f, 0.0f, 0.0f),
-        glm::vec3(0.0f, 1.0f, 0.0f));
+    // the shadowed point light, the flashlight, then the extra lights; written to the stream buffer before the
+    // graph imports the buffer they landed in
+    sceneLights.clear();
+    sceneLights.push_back(LightClusters::pointLight(glm::vec3(-0.2f, 0.6f, 0.0f), glm::vec3(1.0f, 1.0f, 0.6f), 25.0f));
+    sceneLights.push_back(LightClusters::spotLight(camera.Position, camera.Front, glm::vec3(0.0f, 0.0f, 1.0f), 30.0f, 12.5f, 15.0f));
+    sceneLights.insert(sceneLights.end(), extraLightPool.begin(), extraLightPool.begin() + std::min<size_t>(extraLights, extraLightPool.size()));
+    lightClusters.upload(sceneLights);
+
+    // persistent resources the passes touch; everything screen sized is a transient from the pool
+    frameGraph.reset();
+    const FrameGraph::Resource directionalShadow = frameGraph.importTexture("directional shadow map", cascadedShadows.texture());
+    const FrameGraph::Resource pointShadow = frameGraph.importTexture("point shadow map", depthCubemap);
+    const FrameGraph::Resource particles = frameGraph.importBuffer("particles", emitter->particlesBuffer);
+    const FrameGraph::Resource particleFreelist = frameGraph.importBuffer("particle freelist", emitter->freelistBuffer);
+    const FrameGraph::Resource instanceCommands = frameGraph.importBuffer("instance commands", foliage.commandBuffer());
+    const FrameGraph::Resource visibleInstances = frameGraph.importBuffer("visible instances", foliage.visibleBuffer());
+    const FrameGraph::Resource instanceVisibility = frameGraph.importBuffer("instance visibility", foliage.visibilityBuffer());
+    const FrameGraph::Resource lightList = frameGraph.importBuffer("lights", lightClusters.lightBuffer());
+    const FrameGraph::Resource lightGrid = frameGraph.importBuffer("light grid", lightClusters.gridBuffer());
+    const FrameGraph::Resource lightIndices = frameGraph.importBuffer("light indices", lightClusters.indexBuffer());
+    const RenderTargetPool::Desc hdrColor = { framebufferWidth, framebufferHeight, GL_RGBA16F };
+    const RenderTargetPool::Desc depthDesc = { framebufferWidth, framebufferHeight, GL_DEPTH_COMPONENT24, RenderTargetPool::DepthAttachment };
+    const RenderTargetPool::Desc albedoDesc = { framebufferWidth, framebufferHeight, GL_RGBA8 };
+    const RenderTargetPool::Desc normalDesc = { framebufferWidth, framebufferHeight, GL_RGBA16 };
+    FrameGraph::Resource sceneColor, brightColor, sceneDepth, gAlbedo, gNormal, hierarchicalZ, bloomLevels;
+    FrameGraph::Resource particleColor, particleDepth, particleDepthCopy;
 
-    glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-    //pass 1
-    shadowMapShader->use();
-    shadowMapShader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
+    //DIRECTIONAL SHADOW MAP
+    // cascades over the camera frustum up to shadowDistance, refitted every frame
+    cascadedShadows.update(camera.GetViewMatrix(), glm::radians(camera.Zoom), (float)framebufferWidth / (float)framebufferHeight,
+                           0.1f, shadowDistance, towardSun);
 
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    shadowMapShader->setBool("useInstanceMatrix", true);
+    float Near = 1.0f;
+    float Far = 25.0f;
+    glm::vec3 lightPos(-0.2f, 1.1f, 0.05f);
 
-    for (unsigned int i = 0; i < grass->meshes.size(); i++)
-    {
-        glBindVertexArray(grass->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, grass->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, amount
-        );
-    }
-    for (unsigned int i = 0; i < tree->meshes.size(); i++)
-    {
-        glBindVertexArray(tree->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, tree->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, treeAmount
-        );
-    }
-    for (unsigned int i = 0; i < leaves->meshes.size(); i++)
+    // shadow maps keep their static casters until a light or the static geometry changes. The cascades follow
+    // the camera in snapped steps, each is redrawn only once its own matrix moved
+    for (int cascade = 0; cascade < CascadedShadowMap::CascadeCount; cascade++)
+        directionalShadowCache.setLayerLight(cascade, glm::value_ptr(cascadedShadows.matrix(cascade)), 16);
+    const float pointLight[] = { lightPos.x, lightPos.y, lightPos.z, Near, Far };
+    pointShadowCache.setLight(pointLight, 5);
+    if (sceneMoved)
     {
-        glBindVertexArray(leaves->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, leaves->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, treeAmount
-        );
-    }
-    shadowMapShader->setBool("useInstanceMatrix", false);
-    
-    for (auto& child : floorEntity->children) {
-        child->Draw(*shadowMapShader.get());
-
+        directionalShadowCache.invalidate();
+        pointShadowCache.invalidate();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     //POINT SHADOW MAP
+    // one view per cube face, its frustum culls the casters drawn into that face
     float aspect = (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT;
-    float Near = 1.0f;
-    float Far = 25.0f;
     glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspect, Near, Far);
-    
-    glm::vec3 lightPos(-0.2f, 1.1f, 0.05f);
 
     std::vector<glm::mat4> shadowTransforms;
 
@@ -1167,74 +1165,404 @@ void render() {
     shadowTransforms.push_back(shadowProj *
         glm::lookAt(lightPos, lightPos + glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, 1.0, 0.0))); // -Z
 
-    //pass 1
-    pointShadowMapShader->use();
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, cubeDepthMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    for (unsigned int i = 0; i < 6; ++i)
-        pointShadowMapShader->setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-    pointShadowMapShader->setFloat("far_plane", Far);
-    pointShadowMapShader->setVec3("lightPos", lightPos);
-    pointShadowMapShader->setBool("useInstanceMatrix", true);
-    for (unsigned int i = 0; i < grass->meshes.size(); i++)
+    std::array<Frustum, 6> faceFrusta;
+    for (int face = 0; face < 6; face++)
+        faceFrusta[face] = Frustum::fromMatrix(shadowTransforms[face]);
+
+    // every pass drawing foliage gets the instances inside its own view: the camera, each cascade's light box
+    // and each face of the point light's cube. With occlusion culling the scene pass only gets what was
+    // visible last frame, the rest is retested after it (see "occlusion cull")
+    frameGraph.addPass("instance cull", [&](FrameGraph::PassBuilder& pass) {
+        pass.write(instanceCommands, FrameGraph::StorageBuffer);
+        pass.write(visibleInstances, FrameGraph::StorageBuffer);
+        if (occlusionCulling)
+            pass.read(instanceVisibility, FrameGraph::StorageBuffer);
+    }, [&]() {
+        if (occlusionCulling)
+            foliage.cullEarly(cameraFrustum);
+        else
+            foliage.cull(InstanceCuller::CameraView, cameraFrustum);
+        // light views only matter while their shadow map is redrawn
+        for (int cascade = 0; cascade < CascadedShadowMap::CascadeCount; cascade++)
+        {
+            if (directionalShadowCache.stale(cascade))
+                foliage.cull(InstanceCuller::cascadeView(cascade), cascadedShadows.frustum(cascade));
+        }
+        if (pointShadowCache.stale())
+        {
+            for (int face = 0; face < 6; face++)
+                foliage.cull(InstanceCuller::cubeFaceView(face), faceFrusta[face]);
+        }
+    });
+
+    frameGraph.addPass("directional shadow", [&](FrameGraph::PassBuilder& pass) {
+        pass.read(instanceCommands, FrameGraph::Indirect);
+        pass.read(visibleInstances, FrameGraph::StorageBuffer);
+        pass.write(directionalShadow, FrameGraph::Attachment);
+    }, [&]() {
+        //pass 1
+        // all cascades in one layered pass: every draw names the cascade it was culled for, or carries the
+        // mask of the cascades it touches, and reaches those layers alone
+        shadowMapShader->use();
+        cascadedShadows.apply(*shadowMapShader);
+
+        directionalShadowCache.render([&]() {
+            shadowMapShader->setBool("useInstanceMatrix", true);
+
+            foliage.bind();
+            // only the stale cascades, the others keep their depth
+            for (int cascade = 0; cascade < CascadedShadowMap::CascadeCount; cascade++)
+            {
+                if (!directionalShadowCache.stale(cascade))
+                    continue;
+                shadowMapShader->setInt("cascade", cascade);
+                foliage.draw(grassInstances, InstanceCuller::cascadeView(cascade));
+                foliage.draw(treeInstances, InstanceCuller::cascadeView(cascade));
+                foliage.draw(leavesInstances, InstanceCuller::cascadeView(cascade));
+            }
+            shadowMapShader->setBool("useInstanceMatrix", false);
+
+            if (!staticProps.empty())
+            {
+                // one instance per cascade a prop touches, in one multi-draw
+                std::array<Frustum, CascadedShadowMap::CascadeCount> cascadeFrusta;
+                for (int cascade = 0; cascade < CascadedShadowMap::CascadeCount; cascade++)
+                    cascadeFrusta[cascade] = cascadedShadows.frustum(cascade);
+                shadowMapShader->setInt("cascade", -1);
+                staticProps.drawShadowCastersLayered(*shadowMapShader.get(), StaticBatch::CascadeLayers, cascadeFrusta.data(),
+                                                     CascadedShadowMap::CascadeCount, directionalShadowCache.staleLayers());
+            }
+            else
+            {
+                for (int cascade = 0; cascade < CascadedShadowMap::CascadeCount; cascade++)
+                {
+                    if (!directionalShadowCache.stale(cascade))
+                        continue;
+                    shadowMapShader->setInt("cascade", cascade);
+                    const Frustum cascadeFrustum = cascadedShadows.frustum(cascade);
+                    for (auto& child : floorEntity->children) {
+                        const AABB bounds = child->worldBounds();
+                        if (!bounds.empty() && !cascadeFrustum.intersectsBox(bounds))
+                            continue;
+                        child->DrawDepth(*shadowMapShader.get());
+                    }
+                }
+            }
+            shadowMapShader->setInt("cascade", -1);
+        }, dynamicCasterPass(*shadowMapShader, "cascade", CascadedShadowMap::CascadeCount));
+    });
+
+    frameGraph.addPass("point shadow", [&](FrameGraph::PassBuilder& pass) {
+        pass.read(instanceCommands, FrameGraph::Indirect);
+        pass.read(visibleInstances, FrameGraph::StorageBuffer);
+        pass.write(pointShadow, FrameGraph::Attachment);
+    }, [&]() {
+        //pass 1
+        pointShadowMapShader->use();
+        for (unsigned int i = 0; i < 6; ++i)
+            pointShadowMapShader->setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+        pointShadowMapShader->setFloat("far_plane", Far);
+        pointShadowMapShader->setVec3("lightPos", lightPos);
+        // no amplification: every draw reaches only the faces it was culled for
+        pointShadowCache.render([&]() {
+            pointShadowMapShader->setBool("useInstanceMatrix", true);
+            foliage.bind();
+            for (int face = 0; face < 6; face++)
+            {
+                pointShadowMapShader->setInt("face", face);
+                foliage.draw(grassInstances, InstanceCuller::cubeFaceView(face));
+                foliage.draw(treeInstances, InstanceCuller::cubeFaceView(face));
+                foliage.draw(leavesInstances, InstanceCuller::cubeFaceView(face));
+            }
+            pointShadowMapShader->setBool("useInstanceMatrix", false);
+
+            if (!staticProps.empty())
+            {
+                // one instance per face a prop touches, in one multi-draw
+                pointShadowMapShader->setInt("face", -1);
+                staticProps.drawShadowCastersLayered(*pointShadowMapShader.get(), StaticBatch::CubeFaceLayers, faceFrusta.data(), 6);
+            }
+            else
+            {
+                for (int face = 0; face < 6; face++)
+                {
+                    pointShadowMapShader->setInt("face", face);
+                    for (auto& child : floorEntity->children) {
+                        const AABB bounds = child->worldBounds();
+                        if (!bounds.empty() && !faceFrusta[face].intersectsBox(bounds))
+                            continue;
+                        child->DrawDepth(*pointShadowMapShader.get());
+                    }
+                }
+            }
+        }, dynamicCasterPass(*pointShadowMapShader, "face", 6));
+    });
+
+    frameGraph.addPass("particle spawn", [&](FrameGraph::PassBuilder& pass) {
+        pass.write(particles, FrameGraph::StorageBuffer);
+        pass.write(particleFreelist, FrameGraph::StorageBuffer);
+    }, spawnParticles);
+
+    frameGraph.addPass("particle update", [&](FrameGraph::PassBuilder& pass) {
+        pass.read(particles, FrameGraph::StorageBuffer);
+        pass.write(particles, FrameGraph::StorageBuffer);
+        pass.write(particleFreelist, FrameGraph::StorageBuffer);
+    }, updateParticles);
+
+    frameGraph.addPass("light cull", [&](FrameGraph::PassBuilder& pass) {
+        pass.read(lightList, FrameGraph::StorageBuffer);
+        pass.write(lightGrid, FrameGraph::StorageBuffer);
+        pass.write(lightIndices, FrameGraph::StorageBuffer);
+    }, [&]() {
+        lightClusters.cull(camera.GetViewMatrix(), glm::radians(camera.Zoom), (float)framebufferWidth / (float)framebufferHeight,
+                           0.1f, 100.0f, renderWidth, renderHeight);
+    });
+
+    if (depthPrepass)
     {
-        glBindVertexArray(grass->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, grass->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, amount
-        );
+        frameGraph.addPass("depth prepass", [&](FrameGraph::PassBuilder& pass) {
+            sceneDepth = pass.create("scene depth", depthDesc);
+            pass.write(sceneDepth, FrameGraph::Attachment);
+            pass.read(instanceCommands, FrameGraph::Indirect);
+            pass.read(visibleInstances, FrameGraph::StorageBuffer);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({}, sceneDepth));
+            GLState::viewport(0, 0, renderWidth, renderHeight);
+            renderDepthPrepass();
+        });
     }
-    for (unsigned int i = 0; i < tree->meshes.size(); i++)
+
+    // forward: one scene pass shades as it draws. Deferred: the geometry pass fills the G-buffer and the
+    // lighting pass (after the occlusion passes) shades it
+    if (deferredShading)
     {
-        glBindVertexArray(tree->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, tree->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, treeAmount
-        );
+        frameGraph.addPass("gbuffer", [&](FrameGraph::PassBuilder& pass) {
+            gAlbedo = pass.create("gbuffer albedo", albedoDesc);
+            gNormal = pass.create("gbuffer normal", normalDesc);
+            if (depthPrepass)
+                pass.read(sceneDepth, FrameGraph::Attachment);
+            else
+                sceneDepth = pass.create("scene depth", depthDesc);
+            pass.write(gAlbedo, FrameGraph::Attachment);
+            pass.write(gNormal, FrameGraph::Attachment);
+            pass.write(sceneDepth, FrameGraph::Attachment);
+            pass.read(instanceCommands, FrameGraph::Indirect);
+            pass.read(visibleInstances, FrameGraph::StorageBuffer);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ gAlbedo, gNormal }, sceneDepth));
+            GLState::viewport(0, 0, renderWidth, renderHeight);
+            applyCamera(*gbufferShader);
+            applyCamera(*gbufferInstancedShader);
+            renderGBuffer();
+        });
     }
-    for (unsigned int i = 0; i < leaves->meshes.size(); i++)
+    else
     {
-        glBindVertexArray(leaves->meshes[i].VAO);
-        glDrawElementsInstanced(
-            GL_TRIANGLES, leaves->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, treeAmount
-        );
+        frameGraph.addPass("scene", [&](FrameGraph::PassBuilder& pass) {
+            sceneColor = pass.create("scene color", hdrColor);
+            brightColor = pass.create("bright color", hdrColor);
+            if (depthPrepass)
+                pass.read(sceneDepth, FrameGraph::Attachment);
+            else
+                sceneDepth = pass.create("scene depth", depthDesc);
+            pass.write(sceneColor, FrameGraph::Attachment);
+            pass.write(brightColor, FrameGraph::Attachment);
+            pass.write(sceneDepth, FrameGraph::Attachment);
+            pass.read(directionalShadow, FrameGraph::Sampled);
+            pass.read(pointShadow, FrameGraph::Sampled);
+            pass.read(instanceCommands, FrameGraph::Indirect);
+            pass.read(visibleInstances, FrameGraph::StorageBuffer);
+            pass.read(lightList, FrameGraph::StorageBuffer);
+            pass.read(lightGrid, FrameGraph::StorageBuffer);
+            pass.read(lightIndices, FrameGraph::StorageBuffer);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ sceneColor, brightColor }, sceneDepth));
+            GLState::viewport(0, 0, renderWidth, renderHeight);
+
+            //pass 2
+            applySceneLighting(*shader, Far);
+            applySceneLighting(*instancedShader, Far);
+            shader->use();
+            renderScene();
+        });
     }
-    pointShadowMapShader->setBool("useInstanceMatrix", false);
-    for (auto& child : floorEntity->children) {
-        child->Draw(*pointShadowMapShader.get());
 
+    // two-phase occlusion culling: a depth pyramid over what the scene pass drew, every instance in the
+    // frustum tested against it, and those that turn out visible but were not drawn yet drawn on top
+    if (occlusionCulling)
+    {
+        const RenderTargetPool::Desc pyramidDesc = { framebufferWidth, framebufferHeight, GL_R32F, RenderTargetPool::Storage,
+                                                     DepthPyramid::levelsFor(framebufferWidth, framebufferHeight) };
+        frameGraph.addPass("depth pyramid", [&](FrameGraph::PassBuilder& pass) {
+            hierarchicalZ = pass.create("hierarchical z", pyramidDesc);
+            pass.read(sceneDepth, FrameGraph::Sampled);
+            pass.write(hierarchicalZ, FrameGraph::Image);
+        }, [&]() {
+            // over the whole target: past the rendered corner the depth is cleared to far and hides nothing
+            depthPyramid.build(frameGraph.texture(sceneDepth), frameGraph.texture(hierarchicalZ), framebufferWidth, framebufferHeight);
+        });
+
+        frameGraph.addPass("occlusion cull", [&](FrameGraph::PassBuilder& pass) {
+            pass.read(hierarchicalZ, FrameGraph::Sampled);
+            pass.read(instanceVisibility, FrameGraph::StorageBuffer);
+            pass.write(instanceVisibility, FrameGraph::StorageBuffer);
+            pass.write(instanceCommands, FrameGraph::StorageBuffer);
+            pass.write(visibleInstances, FrameGraph::StorageBuffer);
+        }, [&]() {
+            foliage.cullLate(cameraFrustum, cameraViewProjection, frameGraph.texture(hierarchicalZ), renderUvScale());
+        });
+
+        // into the G-buffer while shading is deferred, the lighting pass comes after it
+        frameGraph.addPass("scene late", [&](FrameGraph::PassBuilder& pass) {
+            pass.read(instanceCommands, FrameGraph::Indirect);
+            pass.read(visibleInstances, FrameGraph::StorageBuffer);
+            if (deferredShading)
+            {
+                pass.read(gAlbedo, FrameGraph::Attachment);
+                pass.write(gAlbedo, FrameGraph::Attachment);
+                pass.write(gNormal, FrameGraph::Attachment);
+            }
+            else
+            {
+                pass.read(lightList, FrameGraph::StorageBuffer);
+                pass.read(lightGrid, FrameGraph::StorageBuffer);
+                pass.read(lightIndices, FrameGraph::StorageBuffer);
+                pass.read(sceneColor, FrameGraph::Attachment);
+                pass.write(sceneColor, FrameGraph::Attachment);
+                pass.write(brightColor, FrameGraph::Attachment);
+            }
+            pass.write(sceneDepth, FrameGraph::Attachment);
+        }, [&]() {
+            Shader* lateShader = instancedShader.get();
+            if (deferredShading)
+            {
+                GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ gAlbedo, gNormal }, sceneDepth));
+                lateShader = gbufferInstancedShader.get();
+            }
+            else
+            {
+                GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ sceneColor, brightColor }, sceneDepth));
+                lightClusters.bind();
+            }
+            lateShader->use();
+            foliage.bind();
+            foliage.draw(grassInstances, InstanceCuller::CameraLateView, lateShader);
+            foliage.draw(treeInstances, InstanceCuller::CameraLateView, lateShader);
+            foliage.draw(leavesInstances, InstanceCuller::CameraLateView, lateShader);
+        });
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    //pass 2
-    instancedShader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-    shader->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-    shader->setFloat("far_plane", Far);
-    shader->use();
-    glActiveTexture(GL_TEXTURE12);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    shader->setInt("shadowMap", 12);    
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-    shader->setInt("depthMap", 5);
-
-    reflectionShader->use();
-
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
-    reflectionShader->setMat4("projection", projection);
-    glm::mat4 view = glm::mat4(camera.GetViewMatrix());
-    reflectionShader->setMat4("view", view);
-    reflectionShader->setInt("skybox", 0);
 
-    refractShader->use();
-    refractShader->setMat4("projection", projection);
-    refractShader->setMat4("view", view);
-    refractShader->setInt("skybox", 0);
-    
-    shader->use();
-    renderScene();
+    if (deferredShading)
+    {
+        frameGraph.addPass("deferred lighting", [&](FrameGraph::PassBuilder& pass) {
+            sceneColor = pass.create("scene color", hdrColor);
+            brightColor = pass.create("bright color", hdrColor);
+            pass.write(sceneColor, FrameGraph::Attachment);
+            pass.write(brightColor, FrameGraph::Attachment);
+            pass.read(gAlbedo, FrameGraph::Sampled);
+            pass.read(gNormal, FrameGraph::Sampled);
+            pass.read(sceneDepth, FrameGraph::Sampled);
+            pass.read(directionalShadow, FrameGraph::Sampled);
+            pass.read(pointShadow, FrameGraph::Sampled);
+            pass.read(lightList, FrameGraph::StorageBuffer);
+            pass.read(lightGrid, FrameGraph::StorageBuffer);
+            pass.read(lightIndices, FrameGraph::StorageBuffer);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ sceneColor, brightColor }));
+            GLState::viewport(0, 0, renderWidth, renderHeight);
+            applySceneLighting(*deferredLightingShader, Far);
+            renderDeferredLighting(frameGraph.texture(gAlbedo), frameGraph.texture(gNormal), frameGraph.texture(sceneDepth));
+        });
+
+        frameGraph.addPass("forward", [&](FrameGraph::PassBuilder& pass) {
+            pass.read(sceneColor, FrameGraph::Attachment);
+            pass.write(sceneColor, FrameGraph::Attachment);
+            pass.write(brightColor, FrameGraph::Attachment);
+            pass.read(sceneDepth, FrameGraph::Attachment);
+            pass.write(sceneDepth, FrameGraph::Attachment);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ sceneColor, brightColor }, sceneDepth));
+            renderForwardOnly();
+        });
+    }
+
+    // particles straight into the scene, or off-screen at a fraction of its resolution and upsampled over it
+    if (lowResParticles.enabled())
+    {
+        frameGraph.addPass("particle depth", [&](FrameGraph::PassBuilder& pass) {
+            particleDepth = pass.create("particle depth", lowResParticles.depthDesc(framebufferWidth, framebufferHeight));
+            particleDepthCopy = pass.create("particle depth copy", lowResParticles.depthCopyDesc(framebufferWidth, framebufferHeight));
+            pass.read(sceneDepth, FrameGraph::Sampled);
+            pass.write(particleDepth, FrameGraph::Attachment);
+            pass.write(particleDepthCopy, FrameGraph::Attachment);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ particleDepthCopy }, particleDepth));
+            GLState::viewport(0, 0, lowResParticles.width(renderWidth), lowResParticles.height(renderHeight));
+            lowResParticles.downsampleDepth(frameGraph.texture(sceneDepth));
+        });
+
+        frameGraph.addPass("particles", [&](FrameGraph::PassBuilder& pass) {
+            particleColor = pass.create("particle color", lowResParticles.colorDesc(framebufferWidth, framebufferHeight));
+            pass.read(particles, FrameGraph::StorageBuffer);
+            pass.write(particleColor, FrameGraph::Attachment);
+            pass.read(particleDepth, FrameGraph::Attachment);
+            pass.write(particleDepth, FrameGraph::Attachment);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ particleColor }, particleDepth));
+            GLState::viewport(0, 0, lowResParticles.width(renderWidth), lowResParticles.height(renderHeight));
+            const GLfloat transparent[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            glClearBufferfv(GL_COLOR, 0, transparent);
+            renderParticles();
+        });
+
+        frameGraph.addPass("particle upsample", [&](FrameGraph::PassBuilder& pass) {
+            pass.read(particleColor, FrameGraph::Sampled);
+            pass.read(particleDepthCopy, FrameGraph::Sampled);
+            pass.read(sceneDepth, FrameGraph::Sampled);
+            pass.read(sceneColor, FrameGraph::Attachment);
+            pass.write(sceneColor, FrameGraph::Attachment);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ sceneColor }));
+            GLState::viewport(0, 0, renderWidth, renderHeight);
+            lowResParticles.composite(frameGraph.texture(particleColor), frameGraph.texture(particleDepthCopy),
+                                      frameGraph.texture(sceneDepth), 0.1f, 100.0f, renderWidth, renderHeight);
+        });
+    }
+    else
+    {
+        frameGraph.addPass("particles", [&](FrameGraph::PassBuilder& pass) {
+            pass.read(particles, FrameGraph::StorageBuffer);
+            pass.read(sceneColor, FrameGraph::Attachment);
+            pass.write(sceneColor, FrameGraph::Attachment);
+            pass.write(brightColor, FrameGraph::Attachment);
+            pass.read(sceneDepth, FrameGraph::Attachment);
+        }, [&]() {
+            GLState::bindFramebuffer(GL_FRAMEBUFFER, frameGraph.framebuffer({ sceneColor, brightColor }, sceneDepth));
+            renderParticles();
+        });
+    }
+
+    frameGraph.addPass("bloom", [&](FrameGraph::PassBuilder& pass) {
+        bloomLevels = pass.create("bloom chain", bloomChain.chainDesc(framebufferWidth, framebufferHeight));
+        pass.read(brightColor, FrameGraph::Sampled);
+        pass.write(bloomLevels, FrameGraph::Image);
+    }, [&]() {
+        bloomChain.build(frameGraph.texture(brightColor), frameGraph.texture(bloomLevels), renderWidth, renderHeight,
+                         renderUvScale());
+    });
+
+    // without bloom nothing reads the chain, and the bloom pass is culled
+    frameGraph.addPass("composite", [&](FrameGraph::PassBuilder& pass) {
+        pass.read(sceneColor, FrameGraph::Sampled);
+        if (postProcess.enabled(PostProcess::Bloom))
+            pass.read(bloomLevels, FrameGraph::Sampled);
+        pass.sideEffect();
+    }, [&]() {
+        composite(frameGraph.texture(sceneColor), postProcess.enabled(PostProcess::Bloom) ? frameGraph.texture(bloomLevels) : 0);
+    });
+
+    frameGraph.execute();
+    dynamicResolution.endFrame();
 }
 
 void imgui_begin()
@@ -1259,12 +1587,92 @@ void imgui_render()
         ImGui::SliderFloat("z", &childoffsetZ, 0.0f, 10.0f);            // Edit 1 float using a slider from 0.0f to 1.0f
 
         ImGui::SliderFloat("parentX", &parentOffsetX, 0.0f, 10.0f);            // Edit 1 float using a slider from 0.0f to 1.0f
-        ImGui::Checkbox("blur", &bloom);
+        ImGui::CheckboxFlags("bloom", &postProcess.features, PostProcess::Bloom);
+        ImGui::SliderInt("bloom levels", &bloomChain.levels, 1, Bloom::MaxLevels);
+        ImGui::SliderFloat("bloom radius", &bloomChain.filterRadius, 0.5f, 3.0f);
+        ImGui::CheckboxFlags("vignette", &postProcess.features, PostProcess::Vignette);
+        ImGui::CheckboxFlags("color grading", &postProcess.features, PostProcess::ColorGrading);
+        ImGui::CheckboxFlags("FXAA", &postProcess.features, PostProcess::Fxaa);
+        ImGui::SliderFloat("exposure", &postProcess.exposure, 0.1f, 4.0f);
+        ImGui::Checkbox("occlusion culling", &occlusionCulling);
+        ImGui::Checkbox("deferred shading", &deferredShading);
+        ImGui::Checkbox("depth prepass", &depthPrepass);
+        int runMode = frameLimiter.mode();
+        if (ImGui::Combo("run mode", &runMode, "vsync\0uncapped\0fixed rate\0"))
+            frameLimiter.setMode(static_cast<FrameLimiter::Mode>(runMode));
+        if (frameLimiter.mode() == FrameLimiter::FixedRate)
+        {
+            float targetFps = static_cast<float>(frameLimiter.targetFps());
+            if (ImGui::SliderFloat("target FPS", &targetFps, 10.0f, 240.0f, "%.0f"))
+                frameLimiter.setTargetFps(targetFps);
+        }
+        ImGui::SliderInt("frames in flight", &frameSync.framesInFlight, 1, FrameSync::MaxFramesInFlight);
+        ImGui::Checkbox("dynamic resolution", &dynamicResolution.enabled);
+        ImGui::Text("particle resolution");
+        ImGui::SameLine();
+        ImGui::RadioButton("full", &lowResParticles.divisor, 1);
+        ImGui::SameLine();
+        ImGui::RadioButton("half", &lowResParticles.divisor, 2);
+        ImGui::SameLine();
+        ImGui::RadioButton("quarter", &lowResParticles.divisor, 4);
+        ImGui::SliderFloat("GPU budget (ms)", &dynamicResolution.targetMs, 4.0f, 33.3f);
+        ImGui::SliderFloat("min resolution scale", &dynamicResolution.minScale, 0.25f, 1.0f);
+        ImGui::SliderFloat("max resolution scale", &dynamicResolution.maxScale, 0.25f, 1.0f);
         ImGui::SliderFloat3("dir light color", glm::value_ptr(dirLightColor), 0, 100);
+        ImGui::SliderFloat("shadow distance", &shadowDistance, 5.0f, 100.0f);
+        ImGui::SliderInt("extra lights", &extraLights, 0, static_cast<int>(extraLightPool.size()));
+        ImGui::SliderFloat("cascade split lambda", &cascadedShadows.splitLambda, 0.0f, 1.0f);
 
 
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+        ImGui::Text("Frame %llu: waited %.2f ms for the GPU, %d in flight", static_cast<unsigned long long>(frameSync.frame()),
+                    frameSync.waitMs(), frameSync.framesInFlight);
+        ImGui::Text("Stream buffer: %.1f of %.1f KB this frame", StreamBuffer::usedBytes() / 1024.0f, StreamBuffer::frameCapacity() / 1024.0f);
+        ImGui::Text("Render resolution: %dx%d (%.0f%%), GPU %.2f ms", renderWidth, renderHeight,
+                    dynamicResolution.scale() * 100.0f, dynamicResolution.gpuMs());
+        ImGui::Text("Materials: %s", MaterialTable::modeName(MaterialTable::mode()));
+        ImGui::Text("Shaders: %u programs from SPIR-V, %u from GLSL source", Shader::spirvProgramCount(), Shader::sourceProgramCount());
+        ImGui::Text("Render targets: %zu (%.1f MB), %zu created", RenderTargetPool::targetCount(),
+                    RenderTargetPool::allocatedBytes() / (1024.0 * 1024.0), RenderTargetPool::createdCount());
+        ImGui::Text("Foliage: %u instances, frustum culled on the GPU for %d views", foliage.instanceCount(), InstanceCuller::ViewCount);
+        ImGui::Text("Shadow caches: directional %u redraws (%u cascades) / %u cached frames, point %u / %u",
+                    directionalShadowCache.stats().staticRenders, directionalShadowCache.stats().layerRenders,
+                    directionalShadowCache.stats().cachedFrames,
+                    pointShadowCache.stats().staticRenders, pointShadowCache.stats().cachedFrames);
+        ImGui::Text("Lights: %u, binned into %u clusters, %u of %u indices, %u dropped", lightClusters.lightCount(),
+                    LightClusters::GridX * LightClusters::GridY * LightClusters::GridZ, lightClusters.requestedIndices(),
+                    LightClusters::MaxLightIndices, lightClusters.droppedLights());
+        ImGui::Text("Shadow map layers: %s", vertexLayerShadows ? "vertex shader" : "pass-through geometry shader");
+        ImGui::Text("Cascades end at %.1f / %.1f / %.1f / %.1f", cascadedShadows.splitDistance(0), cascadedShadows.splitDistance(1),
+                    cascadedShadows.splitDistance(2), cascadedShadows.splitDistance(3));
+        const EntityBVH::Stats& bvhStats = sceneBVH.stats();
+        ImGui::Text("Entity BVH: %u of %u entities visible, %u of %u nodes tested", bvhStats.visible, bvhStats.entities,
+                    bvhStats.nodesTested, bvhStats.nodes);
+        ImGui::Text("Static batch: %d of %d draws visible in one multi-draw, arena %zu vertices / %zu indices", staticProps.visibleDrawCount(),
+                    staticProps.drawCount(), GeometryArena::vertexCount(), GeometryArena::indexCount());
+        const RenderQueue::Stats& queueStats = renderQueue.stats();
+        ImGui::Text("Render queue: %u packets, %u programs, %u materials, %u VAOs", queueStats.packets,
+                    queueStats.programs, queueStats.materials, queueStats.vertexArrays);
+
+        if (ImGui::CollapsingHeader("Frame graph"))
+        {
+            const FrameGraph::Stats& stats = frameGraph.stats();
+            ImGui::Text("%u passes, %u culled, %u transients, %u barriers", stats.passes, stats.culled, stats.transients, stats.barriers);
+            for (const std::string& pass : frameGraph.passLog())
+                ImGui::BulletText("%s", pass.c_str());
+        }
+
+        if (ImGui::CollapsingHeader("GL state changes"))
+        {
+            const GLState::Stats& stats = GLState::stats();
+            for (int i = 0; i < GLState::CounterCount; i++)
+            {
+                const GLState::Counter counter = static_cast<GLState::Counter>(i);
+                ImGui::Text("%-16s issued %5u  elided %5u", GLState::counterName(counter), stats.issued[i], stats.elided[i]);
+            }
+        }
         ImGui::End();
     }
 
@@ -1281,10 +1689,12 @@ void imgui_end()
     glfwMakeContextCurrent(window);
     glfwGetFramebufferSize(window, &display_w, &display_h);
 
-    glViewport(0, 0, display_w, display_h);
+    GLState::viewport(0, 0, display_w, display_h);
    
 
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    // the backend sets and restores GL state on its own, so nothing cached can be trusted afterwards
+    GLState::invalidate();
 }
 
 void end_frame()
@@ -1296,6 +1706,7 @@ void end_frame()
     // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
     glfwPollEvents();
     glfwMakeContextCurrent(window);
+    frameLimiter.wait();
     glfwSwapBuffers(window);
 }
 